@@ -51,11 +51,15 @@ then
 fi
 
 rm -f "$OUTDIR"/*
+
+# Solve all the instances with a single process (in batch mode)
+LIST="$(mktemp)"
 for FILENAME in "$INDIR"/*.txt
 do
-	echo -n "$(basename $FILENAME): "
-	"./$EXE" "$FILENAME" "$OUTDIR/$SUMMARY" "$OUTDIR/$(basename $FILENAME)" --test
+	echo "$FILENAME" >> "$LIST"
 done
+"./$EXE" --batch "$LIST" "$OUTDIR/$SUMMARY" "$OUTDIR" --test
+rm -f "$LIST"
 
 
 if [ ! -d "$CMPDIR" ]
@@ -63,6 +63,8 @@ then
 fi
 rm -f "$OUTDIR/"*
 
+# Solve all the listed instances with a single process (in batch mode)
+LIST="$(mktemp)"
 while read FILENAME
 do
 	if [[ "$FILENAME" == \#* ]]
@@ -72,10 +74,11 @@ do
 
 	if [ -e "$INDIR/$FILENAME" ]
 	then
-		echo -n "$(basename $FILENAME): "
-		"./$EXE" "$INDIR/$FILENAME" "$OUTDIR/$SUMMARY" "$OUTDIR/$(basename $FILENAME)" --test
+		echo "$INDIR/$FILENAME" >> "$LIST"
 	fi
 done < $1
+"./$EXE" --batch "$LIST" "$OUTDIR/$SUMMARY" "$OUTDIR" --test
+rm -f "$LIST"
 
 
 if [ ! -d "$CMPDIR" ]
@@ -0,0 +1,96 @@
+#!/bin/bash
+
+# This bash script allows you to test the server mode of the program, sending
+# sequences of requests to its standard input and comparing the responses
+# obtained against the expected ones.
+
+
+# This file is part of CoIoTeSolver.
+
+# CoIoTeSolver is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+
+# CoIoTeSolver is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU General Public License for more details.
+
+# You should have received a copy of the GNU General Public License
+# along with CoIoTeSolver. If not, see <http://www.gnu.org/licenses/>.
+
+
+SCRDIR="$(dirname $0)"
+
+EXE="$SCRDIR/../CoIoTeSolver.out"
+
+if [ ! -e "$EXE" ]
+then
+	echo "Executable file $EXE not found - ABORT"
+	exit -1
+fi
+
+FAILED=0
+
+# Runs the server with the given options, feeding it with the requests read from
+# the standard input, and checks both its exit status and its responses (since it
+# is run at the end of a pipeline, it returns 1 if the test fails)
+# Usage: check NAME EXPECTED_RESPONSES [OPTIONS...]
+check() {
+	local NAME="$1"
+	local EXPECTED="$2"
+	shift 2
+
+	local OBTAINED
+	OBTAINED="$("$EXE" --server "$@")"
+	local STATUS=$?
+	if [ $STATUS -ne 0 ]
+	then
+		echo "$NAME: FAILED (exit status $STATUS)"
+		return 1
+	elif [ "$OBTAINED" != "$EXPECTED" ]
+	then
+		echo "$NAME: FAILED (unexpected responses)"
+		echo "$OBTAINED"
+		return 1
+	else
+		echo "$NAME: OK"
+	fi
+}
+
+# Sends the instance given as first parameter with a SOLVE request, followed by
+# the other parameters as further requests (one per line)
+requests() {
+	local INSTANCE="$1"
+	shift
+
+	printf 'SOLVE 200 %d\n%s' "${#INSTANCE}" "$INSTANCE"
+	printf '%s\n' "$@"
+}
+
+# Instance with two cells, one time period and one user type which cannot be
+# solved, since its only user can do just one of the two activities required
+TWO_CELLS="2 1 1
+1
+0 0
+0 5
+5 0
+0 2
+0 0
+1 0
+"
+
+# Solving again after the maximum number of activities has been changed, without
+# a previous solution, must rebuild the data structures depending on it
+requests "$TWO_CELLS" "SET_ACTIVITIES 1 100000" "RESOLVE 200" "QUIT" |
+	check "resolve after changing the activities" "NO_SOLUTION
+END
+OK
+END
+NO_SOLUTION
+END
+OK
+END" --threads 2 || FAILED=1
+
+exit $FAILED
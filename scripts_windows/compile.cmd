@@ -28,7 +28,7 @@ FOR %%I IN ("%OBJDIR%") DO (SET OBJDIR=%%~fI)
 SET CXX=g++
 SET CXXFLAGS=-Wall -O3 -std=c++11
 SET LIBS=-pthread
-SET SRCFILE=main coiote_solver_io coiote_solver_logic
+SET SRCFILE=main coiote_solver_io coiote_solver_logic solver_server
 
 IF NOT EXIST "%SRCDIR%\" (
 	ECHO The source directory does not exist. ABORT
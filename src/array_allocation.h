@@ -0,0 +1,114 @@
+// This file is part of CoIoTeSolver.
+
+// CoIoTeSolver is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CoIoTeSolver is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with CoIoTeSolver. If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef ARRAY_ALLOCATION_H
+#define ARRAY_ALLOCATION_H
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
+
+/**
+ * \brief Allocation policy using the standard new[] and delete[] operators.
+ *
+ * It can be used with any type of elements.
+**/
+struct default_allocation {
+	/**
+	 * \brief Allocates an array of elements.
+	 * \param size number of elements to be allocated.
+	 * \return pointer to the first element.
+	**/
+	template <class T>
+	static T* allocate(const size_t size) { return new T[size]; }
+
+	/**
+	 * \brief Releases an array previously allocated through allocate().
+	 * \param data pointer to the first element (it may be nullptr).
+	**/
+	template <class T>
+	static void deallocate(T* data) { delete[](data); }
+};
+
+/**
+ * \brief Allocation policy suitable for large arrays which are accessed intensively.
+ *
+ * The arrays are aligned to the cache line size, and the ones larger than a huge page
+ * are aligned to the huge page size and the kernel is advised to back them through
+ * transparent huge pages (where supported), in order to reduce the TLB misses.
+ *
+ * The memory is not initialized, hence each page is physically allocated (on systems
+ * with a first-touch policy, on the NUMA node of the thread) only when first written.
+ * For this reason only trivial types are allowed.
+**/
+struct aligned_allocation {
+	/** \brief Alignment (in bytes) of all the arrays, i.e. the size of a cache line. **/
+	static const size_t alignment = 64;
+	/** \brief Size (in bytes) of a huge page, above which arrays are backed by huge pages. **/
+	static const size_t huge_page_size = 2*1024*1024;
+
+	/**
+	 * \brief Allocates an array of elements.
+	 * \param size number of elements to be allocated.
+	 * \return pointer to the first element.
+	 * \throw std::bad_alloc if the memory cannot be allocated.
+	**/
+	template <class T>
+	static T* allocate(const size_t size) {
+		static_assert(std::is_trivial<T>::value, "aligned_allocation supports only trivial types");
+
+		const size_t bytes = std::max<size_t>(size*sizeof(T), 1);
+		const bool huge = (bytes >= huge_page_size);
+		void* data = nullptr;
+
+#if defined(_WIN32)
+		data = _aligned_malloc(bytes, huge ? huge_page_size : alignment);
+#else
+		if(posix_memalign(&data, huge ? huge_page_size : alignment, bytes) != 0)
+			data = nullptr;
+#if defined(MADV_HUGEPAGE)
+		if(data != nullptr && huge)
+			madvise(data, bytes, MADV_HUGEPAGE); // Only an hint: errors are ignored
+#endif
+#endif
+
+		if(data == nullptr)
+			throw std::bad_alloc();
+		return static_cast<T*>(data);
+	}
+
+	/**
+	 * \brief Releases an array previously allocated through allocate().
+	 * \param data pointer to the first element (it may be nullptr).
+	**/
+	template <class T>
+	static void deallocate(T* data) {
+#if defined(_WIN32)
+		_aligned_free(data);
+#else
+		free(data);
+#endif
+	}
+};
+
+#endif
@@ -0,0 +1,235 @@
+// This file is part of CoIoTeSolver.
+
+// CoIoTeSolver is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CoIoTeSolver is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with CoIoTeSolver. If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef BINARY_INSTANCE_H
+#define BINARY_INSTANCE_H
+
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <vector>
+
+#include "mapped_file.h"
+
+/**
+ * \brief Class providing access to an instance stored in the binary format.
+ *
+ * The binary format is a compact representation of the text instance files, which can be
+ * accessed directly from the memory mapped file without any parsing. It is composed of:
+ * - an header of 24 bytes: the magic string "CoIoTeBI" (8 bytes), the format version, the
+ * number of cells, the number of time periods and the number of customer types (uint32 each);
+ * - the number of activities each user type is able to perform (int32[n_cust_types]);
+ * - the matrix of costs (int32[n_cust_types][n_time_steps][n_cells][n_cells]);
+ * - the number of activities to be done in each cell (int32[n_cells]);
+ * - the number of users available (int32[n_cust_types][n_time_steps][n_cells]).
+ *
+ * All the values are stored in little-endian byte order and the arrays follow the
+ * same order used by the text format.
+**/
+class binary_instance {
+public:
+	/** \brief size_type is defined as an alias of size_t, an unsigned integral type. **/
+	typedef size_t size_type;
+
+	/** \brief Version of the binary format. **/
+	static const uint32_t version = 1;
+	/** \brief Size in bytes of the header. **/
+	static const size_type header_size = 24;
+
+	/**
+	 * \brief Constructor.
+	 *
+	 * Reads the header of the given file and checks that its size is consistent with it.
+	 *
+	 * \param file the memory mapped file containing the instance.
+	**/
+	explicit binary_instance(const mapped_file& file) : binary_instance(file.data(), file.size()) {}
+
+	/**
+	 * \brief Constructor.
+	 *
+	 * Reads the header of the instance stored in the given buffer and checks that its size is consistent with it.
+	 *
+	 * \param buffer pointer to the first byte of the instance (it must outlive this object).
+	 * \param size size in bytes of the buffer.
+	**/
+	binary_instance(const char* buffer, const size_type size) : data(buffer), valid(false) {
+		if(!is_binary(buffer, size) || size < header_size)
+			return;
+
+		_n_cells = read_uint32(data + 12);
+		_n_time_steps = read_uint32(data + 16);
+		_n_cust_types = read_uint32(data + 20);
+
+		// The sizes of the sections are products of untrusted dimensions: each product is bounded
+		// by the number of values the buffer can contain, so that no computation can overflow
+		const size_type max_values = (size - header_size)/4;
+		size_type n_groups, n_sources, n_costs;
+		if(!checked_multiply(_n_cust_types, _n_time_steps, max_values, n_groups) ||
+			!checked_multiply(n_groups, _n_cells, max_values, n_sources) ||
+			!checked_multiply(n_sources, _n_cells, max_values, n_costs) ||
+			_n_cust_types > max_values || _n_cells > max_values)
+			return;
+
+		act_offset = header_size;
+		costs_offset = act_offset + 4*_n_cust_types;
+		activities_offset = costs_offset + 4*n_costs;
+		users_offset = activities_offset + 4*_n_cells;
+		valid = (read_uint32(data + 8) == version && size == users_offset + 4*n_sources);
+	}
+
+	/**
+	 * \brief Checks whether the given file starts with the magic string of the binary format.
+	 * \param file the memory mapped file to be checked.
+	 * \return boolean value.
+	**/
+	static bool is_binary(const mapped_file& file) {
+		return file.is_open() && is_binary(file.data(), file.size());
+	}
+
+	/**
+	 * \brief Checks whether the given buffer starts with the magic string of the binary format.
+	 * \param buffer pointer to the first byte of the buffer.
+	 * \param size size in bytes of the buffer.
+	 * \return boolean value.
+	**/
+	static bool is_binary(const char* buffer, const size_type size) {
+		return size >= sizeof(magic()) && std::memcmp(buffer, magic(), sizeof(magic())) == 0;
+	}
+
+	/**
+	 * \brief Returns whether the file is a correct instance in the binary format.
+	 * \return boolean value.
+	**/
+	inline bool is_valid() const { return valid; }
+
+	/** \brief Returns the number of cells. **/
+	inline size_type n_cells() const { return _n_cells; }
+	/** \brief Returns the number of time periods. **/
+	inline size_type n_time_steps() const { return _n_time_steps; }
+	/** \brief Returns the number of customer types. **/
+	inline size_type n_cust_types() const { return _n_cust_types; }
+
+	/** \brief Returns the number of activities the user type m is able to perform. **/
+	inline int32_t act_per_user(const size_type& m) const {
+		return read_int32(data + act_offset + 4*m);
+	}
+
+	/** \brief Returns the cost to move a user of type m from cell i to cell j in the time period t. **/
+	inline int32_t cost(const size_type& m, const size_type& t, const size_type& i, const size_type& j) const {
+		return read_int32(data + costs_offset + 4*(((m*_n_time_steps + t)*_n_cells + i)*_n_cells + j));
+	}
+
+	/** \brief Returns the number of activities to be done in the cell i. **/
+	inline int32_t activities(const size_type& i) const {
+		return read_int32(data + activities_offset + 4*i);
+	}
+
+	/** \brief Returns the number of users of type m available in the cell i in the time period t. **/
+	inline int32_t users_available(const size_type& m, const size_type& t, const size_type& i) const {
+		return read_int32(data + users_offset + 4*((m*_n_time_steps + t)*_n_cells + i));
+	}
+
+	/**
+	 * \brief Writes the header of the binary format.
+	 * \param output the stream where writing the header.
+	 * \param n_cells number of cells.
+	 * \param n_time_steps number of time periods.
+	 * \param n_cust_types number of customer types.
+	**/
+	static void write_header(std::ostream& output, const size_type& n_cells,
+		const size_type& n_time_steps, const size_type& n_cust_types) {
+
+		std::vector<char> buffer(magic(), magic() + sizeof(magic()));
+		append_int32(buffer, version);
+		append_int32(buffer, n_cells);
+		append_int32(buffer, n_time_steps);
+		append_int32(buffer, n_cust_types);
+		output.write(buffer.data(), buffer.size());
+	}
+
+	/**
+	 * \brief Appends a value to a buffer in little-endian byte order.
+	 * \param buffer the buffer to be extended.
+	 * \param value the value to be appended.
+	**/
+	static void append_int32(std::vector<char>& buffer, const uint32_t value) {
+		for(size_type b = 0; b < 4; b++)
+			buffer.push_back((char)((value >> (8*b)) & 0xFF));
+	}
+
+private:
+	/** \brief Pointer to the first byte of the file. **/
+	const char* data;
+	/** \brief Boolean variable specifying whether the file is correct. **/
+	bool valid;
+
+	size_type _n_cells; /**< \brief Number of cells. **/
+	size_type _n_time_steps; /**< \brief Number of time periods. **/
+	size_type _n_cust_types; /**< \brief Number of customer types. **/
+
+	size_type act_offset; /**< \brief Offset of the activities per user array. **/
+	size_type costs_offset; /**< \brief Offset of the costs matrix. **/
+	size_type activities_offset; /**< \brief Offset of the activities array. **/
+	size_type users_offset; /**< \brief Offset of the users available matrix. **/
+
+	/**
+	 * \brief Returns the magic string identifying the binary format.
+	 * \return reference to the magic string (not null-terminated).
+	**/
+	static const char (&magic())[8] {
+		static const char value[8] = { 'C', 'o', 'I', 'o', 'T', 'e', 'B', 'I' };
+		return value;
+	}
+
+	/**
+	 * \brief Multiplies two sizes, checking that the product does not exceed a limit.
+	 * \param a the first factor.
+	 * \param b the second factor.
+	 * \param limit the maximum value allowed for the product.
+	 * \param product set to the product of the factors, if it does not exceed the limit.
+	 * \return false if the product exceeds the limit, true otherwise.
+	**/
+	static inline bool checked_multiply(const size_type a, const size_type b, const size_type limit, size_type& product) {
+		if(a != 0 && b > limit/a)
+			return false;
+		product = a*b;
+		return true;
+	}
+
+	/**
+	 * \brief Reads an unsigned integer stored in little-endian byte order.
+	 * The compiler reduces it to a plain load on little-endian machines.
+	 * \param ptr pointer to the first byte.
+	 * \return the value read.
+	**/
+	static inline uint32_t read_uint32(const char* ptr) {
+		const unsigned char* bytes = reinterpret_cast<const unsigned char*>(ptr);
+		return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) |
+			((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+	}
+
+	/**
+	 * \brief Reads a signed integer stored in little-endian byte order.
+	 * \param ptr pointer to the first byte.
+	 * \return the value read.
+	**/
+	static inline int32_t read_int32(const char* ptr) {
+		return (int32_t)read_uint32(ptr);
+	}
+};
+
+#endif
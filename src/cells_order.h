@@ -18,134 +18,557 @@
 #define CELLS_ORDER_H
 
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
 #include "multi_array.h"
 
 /**
- * \brief Class implementing a simple way to order the cells of the cost matrix.
+ * \brief Class implementing a compact encoding of the groups of users.
+ *
+ * A group of users (source cell i, user type m, time period t) is packed into a single
+ * 32 bit unsigned integer, which corresponds exactly to the offset of the element
+ * {i, m, t} inside a three dimensional multi_array with dimensions {n_cells, n_cust_types,
+ * n_time_steps}. It is then possible both to decode the single indexes and to directly
+ * access three dimensional arrays without further computations.
+ *
+ * No check is performed about the capacity: the product n_cells * n_cust_types * n_time_steps
+ * is assumed not to exceed the range of a 32 bit unsigned integer.
+**/
+class packed_source {
+public:
+	/** \brief size_type is defined as an alias of size_t. An unsigned integral type. **/
+	typedef size_t size_type;
+	/** \brief value_type represents the type of a packed index. **/
+	typedef uint32_t value_type;
+
+	/** \brief three_index_type represents the correct type to specify an element of a
+	 * three dimensional array implemented through multi_array. **/
+	typedef multi_array<int, 3>::index_type three_index_type;
+
+	/**
+	 * \brief Constructor.
+	 * \param n_cust_types number of different customer types.
+	 * \param n_time_steps number of different time periods.
+	**/
+	packed_source(const size_type& n_cust_types, const size_type& n_time_steps)
+		: n_cust_types(n_cust_types), n_time_steps(n_time_steps) {}
+
+	/**
+	 * \brief Packs the given group of users into a single integer.
+	 * \param i source cell.
+	 * \param m user type.
+	 * \param t time period.
+	 * \return the packed index.
+	**/
+	inline value_type encode(const size_type& i, const size_type& m, const size_type& t) const {
+		return (value_type)((i*n_cust_types + m)*n_time_steps + t);
+	}
+
+	/** \brief Returns the source cell of the packed index. **/
+	inline size_type i(const value_type& packed) const { return packed / (n_cust_types*n_time_steps); }
+	/** \brief Returns the user type of the packed index. **/
+	inline size_type m(const value_type& packed) const { return (packed / n_time_steps) % n_cust_types; }
+	/** \brief Returns the time period of the packed index. **/
+	inline size_type t(const value_type& packed) const { return packed % n_time_steps; }
+
+	/**
+	 * \brief Unpacks the given index.
+	 * \param packed the packed index.
+	 * \return the corresponding three_index_type.
+	**/
+	inline three_index_type decode(const value_type& packed) const {
+		return { i(packed), m(packed), t(packed) };
+	}
+
+private:
+	const size_type n_cust_types; /**< \brief Number of different customer types. **/
+	const size_type n_time_steps; /**< \brief Number of different time periods. **/
+};
+
+/**
+ * \brief Class implementing a list of the groups of users of a single type sorted by cost.
  *
  * In particular the implementation consists of a stripped-down version of a vector
- * class, providing contiguous storage locations to memorize indexes relative to
- * elements contained inside multi-dimensional arrays caracterized by four dimension.
+ * class, storing the groups of users (source cell and time period) of a given type which
+ * can perform activities in a given destination cell. Since the destination cell is
+ * implicit in the list, each group is stored in the compact form provided by packed_source.
+ *
+ * The data is organized as a structure of arrays: for each element the packed index and
+ * the cost of the move are stored in parallel contiguous arrays, so that the scans done
+ * by the greedy functions stream linearly through memory without having to access the
+ * whole cost matrix. Elements are referred to through their position inside the container.
+ * Since all the users of the list are able to perform the same number of activities,
+ * ordering them by cost is equivalent to ordering them by reduced cost.
  *
  * In order to make the whole process faster, the total capacity of this data structure
  * is fixed and must be set before inserting any element. For the same reason, neither
  * boundary check nor correctness controls are performed.
  *
- * The class also provides, after having ordered the indexes using the dedicated method,
- * a simple way to iterate through all the elements according to the cost order, by
- * automatically skipping those users no more available.
+ * Since usually only the cheapest elements are ever considered, the order is built lazily:
+ * initially only a prefix of the elements is sorted and it is extended (doubling its length)
+ * only when a scan reaches its end. The extension can be requested concurrently by different
+ * threads: it modifies only the elements beyond the sorted prefix, which are not accessed by
+ * readers, and then publishes the new length atomically. Once sorted, the prefix is never left
+ * empty while the container has elements, hence the first element is always the cheapest one.
 **/
-class cells_order {
+class cost_list {
 public:
 	/** \brief size_type is defined as an alias of size_t. An unsigned integral type. **/
 	typedef size_t size_type;
-
-	/** \brief three_index_type represents the correct type to specify an element of a
-	 * three dimensional array implemented through multi_array. **/
-	typedef multi_array<int, 3>::index_type three_index_type;
-	/** \brief four_index_type represents the correct type to specify an element of a
-	 * four dimensional array implemented through multi_array. **/
-	typedef multi_array<int, 4>::index_type four_index_type;
-
-	/** \brief This accessory structure provides a mnemonic way to access the
-	 * different indexes contained inside an element of four_index_type, without having
-	 * to remember their position. **/
-	struct four_index {
-		static const size_type i = 0; /**< \brief Source cell. **/
-		static const size_type j = 1; /**< \brief Destination cell. **/
-		static const size_type m = 2; /**< \brief User type. **/
-		static const size_type t = 3; /**< \brief Time period. **/
-	};
-
-	/** \brief value_type represents the type of data actually stored inside this container. **/
-	typedef four_index_type value_type;
-	/** \brief const_iterator is defined as an alias of const value_type*, a random access iterator to const value_type. **/
-	typedef const value_type* const_iterator;
-	/** \brief iterator is defined as an alias of value_type*, a random access iterator to value_type. **/
-	typedef value_type* iterator;
+	/** \brief source_type represents the type of the packed indexes stored inside this container. **/
+	typedef packed_source::value_type source_type;
+	/** \brief cost_type represents the type of the costs (non-negative integers), used also as sort keys. **/
+	typedef uint32_t cost_type;
 
 	/**
 	 * \brief Default constructor. Constructs an empty container, with no elements.
 	**/
-	cells_order() : _begin(nullptr), _end(nullptr), _capacity(nullptr) {}
+	cost_list() : _sources(nullptr), _costs(nullptr), _act_per_user(0),
+		_size(0), _capacity(0), _sorted(0) {}
 
 	/**
 	 * \brief Destructor.
 	**/
-	~cells_order() { delete[](_begin); }
+	~cost_list() { deallocate(); }
 
 	/**
-	 * \brief Initializes the container with the given capacity, deleting the
-	 * data previously stored (if any).
+	 * \brief Initializes the container with the given capacity, discarding the
+	 * data previously stored (if any). The memory is reallocated only if the current one is not enough.
 	 * \param capacity maximum number of elements that can be stored.
+	 * \param act_per_user number of activities each user of the list is able to perform.
 	**/
-	void initialize(size_type capacity) {
-		delete[](_begin);
-		_begin = _end = new value_type[capacity];
-		_capacity = _begin + capacity;
+	void initialize(size_type capacity, const int act_per_user) {
+		if(capacity > _capacity) {
+			deallocate();
+			_sources = new source_type[capacity];
+			_costs = new cost_type[capacity];
+			_capacity = capacity;
+		}
+		_act_per_user = act_per_user;
+		_size = 0;
+		_sorted.store(0, std::memory_order_relaxed);
+	}
+
+	/**
+	 * \brief Replaces the content of the container with a copy of another one (including
+	 * the part of the order already computed), allocating only the memory strictly necessary.
+	 * \param other the container to be copied (it may be concurrently extended by other threads).
+	**/
+	void assign(const cost_list& other) {
+		std::lock_guard<std::mutex> lock(other.extend_mutex);
+		initialize(other._size, other._act_per_user);
+		std::copy(other._sources, other._sources + other._size, _sources);
+		std::copy(other._costs, other._costs + other._size, _costs);
+		_size = other._size;
+		_sorted.store(other._sorted.load(std::memory_order_relaxed), std::memory_order_relaxed);
 	}
 
 	/**
 	 * \brief Adds a new element at the end of the vector, after its current last element.
-	 * \param item value to be copied to the new element.
+	 * \param source packed index of the group of users.
+	 * \param cost cost of moving one user of the group to the destination cell.
+	**/
+	inline void push_back(const source_type& source, const cost_type cost) {
+		_sources[_size] = source;
+		_costs[_size] = cost;
+		++_size;
+	}
+
+	/**
+	 * \brief Inserts a new element, preserving the part of the order already computed.
+	 *
+	 * If the cost is not lower than the ones in the sorted prefix, the element is simply added to the
+	 * part still to be sorted. Otherwise its position inside the prefix is found through a binary search
+	 * and the following elements of the prefix are shifted by one, moving the first element still to be
+	 * sorted at the end of the container. The prefix is usually short (it is extended only on demand),
+	 * hence the cost is dominated by the search. If the prefix is empty, it is extended to the cheapest
+	 * element. It must not be called concurrently with other methods.
+	 *
+	 * \param source packed index of the group of users.
+	 * \param cost cost of moving one user of the group to the destination cell.
+	**/
+	void insert(const source_type& source, const cost_type cost) {
+		if(_size == _capacity)
+			reserve((_capacity > 0) ? 2*_capacity : initial_sorted);
+
+		const size_type sorted = _sorted.load(std::memory_order_relaxed);
+		const size_type pos = std::upper_bound(_costs, _costs + sorted, cost) - _costs;
+		if(pos == sorted) {
+			push_back(source, cost);
+			if(sorted == 0)
+				extend(0); // Keep the first element the cheapest one
+			return;
+		}
+
+		_sources[_size] = _sources[sorted];
+		_costs[_size] = _costs[sorted];
+		std::copy_backward(_sources + pos, _sources + sorted, _sources + sorted + 1);
+		std::copy_backward(_costs + pos, _costs + sorted, _costs + sorted + 1);
+		_sources[pos] = source;
+		_costs[pos] = cost;
+		++_size;
+		_sorted.store(sorted + 1, std::memory_order_relaxed);
+	}
+
+	/**
+	 * \brief Removes an element, preserving the part of the order already computed.
+	 *
+	 * If the element belongs to the sorted prefix, it is found through a binary search on the cost and
+	 * the following elements of the prefix are shifted back by one, otherwise the part still to be sorted
+	 * is scanned and the element is replaced by the last one. If the prefix becomes empty, it is extended
+	 * again to the cheapest remaining element. It must not be called concurrently with other methods.
+	 *
+	 * \param source packed index of the group of users.
+	 * \param cost cost of moving one user of the group to the destination cell (the one used to insert it).
+	 * \return false if the element has not been found, true otherwise.
 	**/
-	inline void push_back(const value_type& item) { *(_end++) = item; }
+	bool remove(const source_type& source, const cost_type cost) {
+		const size_type sorted = _sorted.load(std::memory_order_relaxed);
+		size_type pos = std::lower_bound(_costs, _costs + sorted, cost) - _costs;
+		while(pos < sorted && _costs[pos] == cost && _sources[pos] != source)
+			++pos;
+
+		if(pos < sorted && _costs[pos] == cost) {
+			// The prefix is shortened by one and the hole is filled with the last element
+			std::copy(_sources + pos + 1, _sources + sorted, _sources + pos);
+			std::copy(_costs + pos + 1, _costs + sorted, _costs + pos);
+			_sources[sorted - 1] = _sources[_size - 1];
+			_costs[sorted - 1] = _costs[_size - 1];
+			--_size;
+			_sorted.store(sorted - 1, std::memory_order_relaxed);
+			if(sorted == 1)
+				extend(0); // Keep the first element the cheapest one
+			return true;
+		}
+
+		for(pos = sorted; pos < _size; pos++) {
+			if(_sources[pos] == source) {
+				_sources[pos] = _sources[_size - 1];
+				_costs[pos] = _costs[_size - 1];
+				--_size;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/**
+	 * \brief Sorts the data structure according to not-decreasing costs.
+	 *
+	 * Only the elements with the smallest costs are moved, in order, at the beginning
+	 * of the container. The rest of the order is computed on demand.
+	**/
+	void sort() {
+		_sorted.store(0, std::memory_order_relaxed);
+		extend(initial_sorted - 1);
+	}
+
+	/**
+	 * \brief Makes sure that the order has been computed up to the given position.
+	 * \param pos the position of the element to be accessed.
+	**/
+	inline void ensure_sorted(const size_type& pos) const {
+		if(pos >= _sorted.load(std::memory_order_acquire) && pos < _size)
+			extend(pos);
+	}
+
+	/**
+	  \brief Returns the position of the least expensive available user.
+	  \param begin the position of the first element to be considered (for subsequent calls).
+	  \param users_available a reference to the data structure containing the users still available
+	  (the packed indexes are used directly as offsets inside it).
+	  \return position of the least expensive element, or size() if no user is available.
+	**/
+	inline size_type get_least_expensive(size_type begin, const multi_array<int, 3>& users_available) const {
+		multi_array<int, 3>::const_iterator available = users_available.begin();
+		for(;;) {
+			const size_type sorted = _sorted.load(std::memory_order_acquire);
+			while(begin != sorted && available[_sources[begin]] <= 0)
+				++begin;
+			if(begin != sorted || sorted == _size)
+				return begin;
+			extend(begin);
+		}
+	}
+
+	/** \brief Returns the packed index of the element at the given position. **/
+	inline source_type source(const size_type& pos) const { return _sources[pos]; }
+	/** \brief Returns the cost of the element at the given position. **/
+	inline double cost(const size_type& pos) const { return (double)_costs[pos]; }
+	/** \brief Returns the cost of the element at the given position as an integer. **/
+	inline cost_type integer_cost(const size_type& pos) const { return _costs[pos]; }
+	/** \brief Returns the number of activities each user of the list is able to perform. **/
+	inline int act_per_user() const { return _act_per_user; }
 
 	/**
-	 * \brief Sorts the data structure according to the comparator passed as parameter.
-	 * \param comparator binary function that accepts two elements in the range as
-	 * arguments, and returns a value convertible to bool. The value returned indicates
-	 * whether the element passed as first argument is considered to go before the second
-	 * in the specific strict weak ordering it defines. The function shall not modify any
-	 * of its arguments. This can either be a function pointer or a function object.
+	 * \brief Returns the number of elements stored in the container.
+	 * \return the number of elements, which is also the past-the-end position.
 	**/
-	template <typename Comparator>
-	inline void sort(Comparator comparator) { std::sort(_begin, _end, comparator); }
+	inline size_type size() const { return _size; }
+
+private:
+	/** \brief Array storing the packed indexes of the groups of users. **/
+	source_type* _sources;
+	/** \brief Array storing the costs of the moves (also used as sort keys). **/
+	cost_type* _costs;
+	/** \brief Number of activities each user of the list is able to perform. **/
+	int _act_per_user;
+
+	/** \brief Number of elements inserted in the container. **/
+	size_type _size;
+	/** \brief Number of elements allocated in the container. **/
+	size_type _capacity;
+	/** \brief Number of elements (at the beginning of the container) already sorted. **/
+	mutable std::atomic<size_type> _sorted;
+	/** \brief Mutex used to serialize the extensions of the sorted prefix. **/
+	mutable std::mutex extend_mutex;
+
+	/** \brief Number of elements sorted initially. **/
+	static const size_type initial_sorted = 256;
+	/** \brief Minimum number of elements to be sorted through the radix sort instead of the comparison one. **/
+	static const size_type radix_threshold = 4096;
+
+	/** \brief Releases the memory allocated for the arrays. **/
+	void deallocate() {
+		delete[](_sources);
+		delete[](_costs);
+	}
 
 	/**
-	  \brief Returns a const_iterator that points to the least expensive available user.
-	  \param begin an const_iterator pointing to the first cell to be considered (for subsequent calls).
-	  \param users_available a reference to the data structure containing the users still available.
-	  \return const_iterator pointing to the least expensive element.
+	 * \brief Enlarges the arrays, preserving their content.
+	 * \param capacity new number of elements allocated (not lower than the current one).
 	**/
-	inline const_iterator get_least_expensive(const_iterator begin,	const multi_array<int, 3>& users_available) const {
-		while(begin != _end && users_available[convert_index(*begin)] <= 0)
-			++begin;
-		return begin;
+	void reserve(const size_type& capacity) {
+		source_type* sources = new source_type[capacity];
+		cost_type* costs = new cost_type[capacity];
+		std::copy(_sources, _sources + _size, sources);
+		std::copy(_costs, _costs + _size, costs);
+		deallocate();
+		_sources = sources;
+		_costs = costs;
+		_capacity = capacity;
 	}
 
 	/**
-	 * \brief Returns a const_iterator pointing to the first element of the container object.
-	 * \return const_iterator pointing to the first element.
+	 * \brief Extends the sorted prefix so that it includes at least the given position.
+	 *
+	 * The prefix length is at least doubled, in order to amortize the cost of the extensions:
+	 * the elements to be added are selected through a partial ordering of the remaining ones
+	 * and then sorted (ties are broken according to the position, to get a deterministic order),
+	 * using a radix sort if they are many.
+	 *
+	 * \param pos the position to be included in the sorted prefix.
 	**/
-	inline const_iterator begin() const { return _begin; }
+	void extend(const size_type& pos) const {
+		std::lock_guard<std::mutex> lock(extend_mutex);
+		const size_type sorted = _sorted.load(std::memory_order_relaxed);
+		if(pos < sorted || sorted == _size)
+			return; // Already extended by another thread
+
+		const size_type new_sorted = std::min(_size, std::max(pos+1, 2*sorted));
+		std::vector<source_type> permutation(_size - sorted);
+		for(size_type a = 0; a < permutation.size(); a++)
+			permutation[a] = (source_type)(sorted + a);
+
+		auto compare = [this](const source_type& lhs, const source_type& rhs) {
+			return _costs[lhs] < _costs[rhs] || (_costs[lhs] == _costs[rhs] && lhs < rhs);
+		};
+		const std::vector<source_type>::iterator middle = permutation.begin() + (new_sorted - sorted);
+		if(middle != permutation.end())
+			std::nth_element(permutation.begin(), middle, permutation.end(), compare);
+		if((size_type)(middle - permutation.begin()) >= radix_threshold)
+			radix_sort(permutation.data(), permutation.data() + (new_sorted - sorted));
+		else
+			std::sort(permutation.begin(), middle, compare);
+
+		apply_permutation(_sources, sorted, permutation);
+		apply_permutation(_costs, sorted, permutation);
+
+		_sorted.store(new_sorted, std::memory_order_release);
+	}
 
 	/**
-	 * \brief Returns an iterator pointing to the past-the-end element of the container object.
+	 * \brief Sorts a range of positions according to not-decreasing costs (and positions in case of ties).
 	 *
-	 * The past-the-end element is the theoretical element that would follow the last element in the vector.
-	 * It does not point to any element, and thus shall not be dereferenced.
+	 * An LSD radix sort with 8 bit digits is used: the first passes sort the elements according
+	 * to the positions and the following ones according to the costs, only for the number of
+	 * digits actually used by the largest values.
 	 *
-	 * \return const_iterator pointing to the past-the-end element.
+	 * \param first pointer to the first position to be sorted.
+	 * \param last pointer to the past-the-end position to be sorted.
 	**/
-	inline const_iterator end() const { return _end; }
+	void radix_sort(source_type* first, source_type* last) const {
+		const size_type n = last - first;
+		cost_type max_cost = 0;
+		for(const source_type* it = first; it != last; ++it)
+			max_cost = std::max(max_cost, _costs[*it]);
 
-private:
-	/** \brief An iterator pointing to the first element in the container. **/
-	iterator _begin;
-	/** \brief An iterator pointing to the past-the-end inserted element in the container. **/
-	iterator _end;
-	/** \brief An iterator pointing to the past-the-end allocated element in the container. **/
-	iterator _capacity;
+		const unsigned position_passes = digits(_size - 1), cost_passes = digits(max_cost);
+		std::vector<source_type> buffer(n);
+		source_type* from = first;
+		source_type* to = buffer.data();
+
+		for(unsigned pass = 0; pass < position_passes + cost_passes; pass++) {
+			const bool on_position = (pass < position_passes);
+			const unsigned shift = 8 * (on_position ? pass : pass - position_passes);
+
+			// Count the elements for each digit and compute the first position of each bucket
+			size_type count[257] = {};
+			for(size_type a = 0; a < n; a++)
+				++count[((on_position ? (cost_type)from[a] : _costs[from[a]]) >> shift & 0xFF) + 1];
+			for(size_type d = 1; d < 257; d++)
+				count[d] += count[d-1];
+
+			// Move the elements into the buckets, preserving their relative order
+			for(size_type a = 0; a < n; a++)
+				to[count[(on_position ? (cost_type)from[a] : _costs[from[a]]) >> shift & 0xFF]++] = from[a];
+			std::swap(from, to);
+		}
+
+		if(from != first)
+			std::copy(from, from + n, first);
+	}
 
 	/**
-	 * \brief Converts a four_index_type elmentent into a three_index_type one by removing the destination cell.
-	 * \param idx a reference to the four_index_type to be converted.
-	 * \return const three_index_type the converted index.
+	 * \brief Returns the number of 8 bit digits needed to represent the given value.
+	 * \param value the value.
+	 * \return the number of digits.
 	**/
-	const three_index_type convert_index(const four_index_type& idx) const {
-		return { idx[four_index::i], idx[four_index::m], idx[four_index::t] };
+	static unsigned digits(uint64_t value) {
+		unsigned n = 0;
+		for(; value > 0; value >>= 8)
+			n++;
+		return n;
 	}
+
+	/**
+	 * \brief Reorders the final part of an array according to the given permutation.
+	 * \param data the array to be reordered.
+	 * \param first the position of the first element to be reordered.
+	 * \param permutation for each position (starting from first), the previous position of the element to be stored there.
+	**/
+	template <typename T>
+	static void apply_permutation(T* data, const size_type& first, const std::vector<source_type>& permutation) {
+		std::vector<T> copy(data + first, data + first + permutation.size());
+		for(size_type a = 0; a < permutation.size(); a++)
+			data[first + a] = copy[permutation[a] - first];
+	}
+};
+
+/**
+ * \brief Class implementing a simple way to order the cells of the cost matrix.
+ *
+ * For a given destination cell, the groups of users (source cell, user type and time period)
+ * are stored in a different cost_list for each user type. The order according to reduced costs
+ * (i.e. the cost divided by the minimum between the number of activities the user type can do
+ * and a limit depending on the remaining demand) is then obtained by merging on the fly the
+ * lists, so that a single copy of the data serves all the possible limits.
+ *
+ * The iteration is performed through an array of positions, one for each list, which is
+ * advanced by the caller: at each step the list whose first available user has the least
+ * reduced cost is returned (ties are broken according to the packed indexes, which corresponds
+ * to the order the users are inserted in the lists).
+**/
+class cells_order {
+public:
+	/** \brief size_type is defined as an alias of size_t. An unsigned integral type. **/
+	typedef size_t size_type;
+
+	/**
+	 * \brief Default constructor. Constructs an empty container, with no lists.
+	**/
+	cells_order() : lists(nullptr), n_lists(0) {}
+
+	/**
+	 * \brief Destructor.
+	**/
+	~cells_order() { delete[](lists); }
+
+	/**
+	 * \brief Initializes the container with the given number of (empty) lists,
+	 * deleting the data previously stored (if any).
+	 * \param n_cust_types number of different customer types.
+	**/
+	void initialize(const size_type& n_cust_types) {
+		delete[](lists);
+		lists = new cost_list[n_cust_types];
+		n_lists = n_cust_types;
+	}
+
+	/**
+	 * \brief Replaces the content of the container with a copy of another one.
+	 * \param other the container to be copied.
+	**/
+	void assign(const cells_order& other) {
+		initialize(other.n_lists);
+		for(size_type m = 0; m < n_lists; m++)
+			lists[m].assign(other.lists[m]);
+	}
+
+	/** \brief Returns the list associated to the user type m. **/
+	inline cost_list& list(const size_type& m) { return lists[m]; }
+	/** \brief Returns the list associated to the user type m. **/
+	inline const cost_list& list(const size_type& m) const { return lists[m]; }
+
+	/**
+	 * \brief Returns the number of lists, which is also the value returned when no user is available.
+	 * \return the number of lists.
+	**/
+	inline size_type size() const { return n_lists; }
+
+	/**
+	 * \brief Advances each position to the first available user of the corresponding list.
+	 * \param positions array storing a position for each list.
+	 * \param users_available a reference to the data structure containing the users still available.
+	**/
+	inline void skip_unavailable(size_type* positions, const multi_array<int, 3>& users_available) const {
+		for(size_type m = 0; m < n_lists; m++)
+			positions[m] = lists[m].get_least_expensive(positions[m], users_available);
+	}
+
+	/**
+	 * \brief Returns the list containing the available user with the least reduced cost.
+	 *
+	 * The positions are advanced to the first available user of each list (see
+	 * skip_unavailable()) and the user considered is the one at the returned position.
+	 * The reduced costs are compared exactly, through integer cross multiplications.
+	 *
+	 * \param positions array storing a position for each list.
+	 * \param max_done maximum number of the activities each user type is allowed to do.
+	 * \param users_available a reference to the data structure containing the users still available.
+	 * \return index of the list of the least expensive user, or size() if no user is available.
+	**/
+	inline size_type get_least_expensive(size_type* positions, const int max_done,
+		const multi_array<int, 3>& users_available) const {
+
+		skip_unavailable(positions, users_available);
+
+		size_type best = n_lists;
+		uint64_t best_cost = 0, best_done = 1;
+		for(size_type m = 0; m < n_lists; m++) {
+			if(positions[m] == lists[m].size())
+				continue;
+
+			const uint64_t cost = lists[m].integer_cost(positions[m]);
+			const uint64_t done = std::min(lists[m].act_per_user(), max_done);
+			if(best == n_lists || cost*best_done < best_cost*done || (cost*best_done == best_cost*done &&
+					lists[m].source(positions[m]) < lists[best].source(positions[best]))) {
+				best = m;
+				best_cost = cost;
+				best_done = done;
+			}
+		}
+		return best;
+	}
+
+private:
+	/** \brief Array storing the lists of users, one for each user type. **/
+	cost_list* lists;
+	/** \brief Number of lists. **/
+	size_type n_lists;
 };
 
 #endif
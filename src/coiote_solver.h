@@ -18,12 +18,21 @@
 #define COIOTE_SOLVER_H
 
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
 #include <random>
 #include <vector>
 
 #include "multi_array.h"
+#include "sparse_solution.h"
+#include "tracked_array.h"
 #include "activities_slots.h"
+#include "binary_instance.h"
 #include "cells_order.h"
+#include "cpu_topology.h"
+#include "text_scanner.h"
 
 
 /**
@@ -53,6 +62,20 @@ private:
 	 * four dimensional array implemented through multi_array. **/
 	typedef multi_array<int, 4>::index_type four_index_type;
 
+	/** \brief cost_type represents the type of the costs of the moves (which are integers). **/
+	typedef int32_t cost_type;
+	/** \brief objective_type represents the type of the objective function values, which are
+	 * accumulated exactly as 64 bit integers. **/
+	typedef int64_t objective_type;
+
+	/** \brief costs_matrix_type represents the type of the matrix storing the costs of the moves. **/
+	typedef multi_array<cost_type, 4, aligned_allocation> costs_matrix_type;
+
+	/** \brief Objective function value denoting that no solution has been found. **/
+	static constexpr objective_type no_solution = std::numeric_limits<objective_type>::max();
+	/** \brief Objective function value denoting that the construction of a solution has been aborted. **/
+	static constexpr objective_type aborted_solution = no_solution - 1;
+
 	/** \brief vector_moves_type represents the chosen data structure to contain a series
 	 * of moves (i.e. visited cells or single elements of the solution) **/
 	typedef std::vector<four_index_type> vector_moves_type;
@@ -89,19 +112,93 @@ public:
 		NO_SOLUTION /**< No solution has been found. **/
 	};
 
+	/** \brief Data structure containing the parameters which tune the behavior of the solver. **/
+	struct settings {
+		/** \brief Number of threads used to solve the problem. **/
+		unsigned n_threads;
+		/** \brief Number of threads used to read the instance file. **/
+		unsigned n_load_threads;
+		/** \brief Whether the threads solving the problem have to be pinned to the allowed CPUs. **/
+		bool pin_threads;
+		/** \brief Whether the data read by the threads solving the problem has to be replicated on
+		 * each NUMA node (it implies that the threads are pinned). **/
+		bool numa_replicas;
+		/** \brief Minimum gain, relative to the objective function value, expected in the remaining time
+		 * for the search to continue (zero to always use all the available time). **/
+		double stop_gain;
+		/** \brief Relative gap between the objective function value and the lower bound below which
+		 * the search is stopped (zero to stop only when the solution is proven to be optimal). **/
+		double gap_tolerance;
+		/** \brief Whether the lower bound has to be raised through a Lagrangian relaxation while searching
+		 * (always done if gap_tolerance is positive). It takes the place of one of the threads, if more than one. **/
+		bool lagrangian_bound;
+
+		/**
+		 * \brief Constructor.
+		 *
+		 * The numbers of threads are set by default to the number of CPUs the process is
+		 * actually allowed to use (see cpu_topology), the pinning and the replication are disabled
+		 * all the available time is used and only the simple lower bound is computed.
+		**/
+		settings() : n_threads(cpu_topology().available_threads()), n_load_threads(n_threads),
+			pin_threads(false), numa_replicas(false), stop_gain(0), gap_tolerance(0), lagrangian_bound(false) {}
+	};
+
 	/**
 	 * \brief Constructor.
 	 *
 	 * The constructor creates the coiote_solver object given the problem instance.
 	 *
-	 * \param input_file the stream linked to the instance file. The first line, providing the dimensions
-	 * problem has to be already read. No check are done about the correctness of the file: in the case
-	 * it does not fulfill the standard, the behavior of this and other methods is completely undefined.
+	 * \param input the scanner linked to the instance file. The first line, providing the dimensions
+	 * of the problem, has to be already read. Only the syntax of the numbers is checked, not the
+	 * consistency of the values read.
 	 * \param n_cells number of cells in the current instance file.
-	 * \param n_custtypes number of different customer types in the current instance file.
 	 * \param n_timesteps number of different time periods in the current instance file.
+	 * \param n_custtypes number of different customer types in the current instance file.
+	 * \param config the parameters of the solver.
+	 * \throw parse_error if the instance file does not respect the expected format.
+	**/
+	coiote_solver(text_scanner& input, const size_type& n_cells, const size_type& n_timesteps,
+		const size_type& n_custtypes, const settings& config);
+
+	/**
+	 * \brief Constructor.
+	 *
+	 * The constructor creates the coiote_solver object given the problem instance stored
+	 * in the binary format. The data is copied directly from the memory mapped file,
+	 * without any parsing.
+	 *
+	 * \param instance the instance file in the binary format. It must be valid (see binary_instance::is_valid()).
+	 * \param config the parameters of the solver.
+	**/
+	coiote_solver(const binary_instance& instance, const settings& config);
+
+	/**
+	 * \brief Replaces the problem instance with a new one having the same dimensions.
+	 *
+	 * All the data structures already allocated are reused and the previous solution is discarded.
+	 * In case the instance file does not respect the expected format, the content of the problem
+	 * is unspecified and the object should not be used to solve it.
+	 *
+	 * \param input the scanner linked to the instance file (the first line has to be already read).
+	 * \param n_cells number of cells in the new instance file.
+	 * \param n_timesteps number of different time periods in the new instance file.
+	 * \param n_custtypes number of different customer types in the new instance file.
+	 * \return false if the dimensions differ from the current ones (nothing is modified), true otherwise.
+	 * \throw parse_error if the instance file does not respect the expected format.
 	**/
-	coiote_solver(std::istream& input_file, const size_type& n_cells, const size_type& n_custtypes, const size_type& n_timesteps);
+	bool reload(text_scanner& input, const size_type& n_cells, const size_type& n_timesteps,
+		const size_type& n_custtypes);
+
+	/**
+	 * \brief Replaces the problem instance with a new one, stored in the binary format, having the same dimensions.
+	 *
+	 * All the data structures already allocated are reused and the previous solution is discarded.
+	 *
+	 * \param instance the instance file in the binary format. It must be valid (see binary_instance::is_valid()).
+	 * \return false if the dimensions differ from the current ones (nothing is modified), true otherwise.
+	**/
+	bool reload(const binary_instance& instance);
 
 	/**
 	 * \brief Tries to solve the problem.
@@ -116,16 +213,63 @@ public:
 	 *
 	 * In the case the result is not as expected, in this specific function and in other
 	 * methods, it is possible to tune some simple parameters (e.g. the fraction of available
-	 * time actually used or the number of threads generated) in order to adapt it to
-	 * the current environment and instance type.
+	 * time actually used) in order to adapt it to the current instance type, while the number
+	 * of threads generated is specified through the settings.
 	 *
 	 * \param time_limit_ms the maximum time in milliseconds that the method can use to produce a solution.
 	 * \return a boolean variable reporting if the method has been able to find a feasible solution or not.
 	**/
 	bool solve(const unsigned long time_limit_ms);
 
+	/**
+	 * \brief Changes the number of activities to be done in a cell of the current instance.
+	 *
+	 * The change is taken into account by the next call to solve() or resolve().
+	 *
+	 * \param j the cell.
+	 * \param activities the new number of activities.
+	 * \return false if the parameters are out of range (nothing is modified), true otherwise.
+	**/
+	bool set_activities(const size_type& j, const int activities);
+
+	/**
+	 * \brief Changes the number of users available in a cell of the current instance.
+	 *
+	 * The change is taken into account by the next call to solve() or resolve().
+	 *
+	 * \param i the cell.
+	 * \param m the user type.
+	 * \param t the time period.
+	 * \param users the new number of users available.
+	 * \return false if the parameters are out of range (nothing is modified), true otherwise.
+	**/
+	bool set_users_available(const size_type& i, const size_type& m, const size_type& t, const int users);
+
+	/**
+	 * \brief Tries to solve again the problem after some changes to the instance, starting from the current solution.
+	 *
+	 * Instead of building new solutions from scratch, the current one is repaired locally: the users no
+	 * longer available and the ones in excess in the cells whose demand has decreased are removed, then
+	 * the demand left unsatisfied is covered according to the same criterion of the greedy function.
+	 * The result is then improved through the improving phase, until no further gain is obtained or the
+	 * time is finished. The cost-based orders are not computed again: the groups of users which
+	 * have become available or unavailable are inserted into or removed from them, while only the
+	 * lists of the cells whose demand has become (or ceased to be) positive are built again.
+	 *
+	 * In the case no solution is available, or the current one cannot be repaired, the problem is
+	 * solved from scratch through solve() in the remaining time.
+	 *
+	 * \param time_limit_ms the maximum time in milliseconds that the method can use to produce a solution.
+	 * \return a boolean variable reporting if the method has been able to find a feasible solution or not.
+	**/
+	bool resolve(const unsigned long time_limit_ms);
+
 	/**
 	 * \brief Writes some KPIs related to the solution on the output stream.
+	 *
+	 * The line contains the identifier of the instance, the objective function value, the elapsed time,
+	 * the number of users moved for each type and, at the end, the relative gap from the lower bound.
+	 *
 	 * \param output_file the stream linked to the file where writing such information.
 	 * \param instance_name the identifier of the current instance.
 	**/
@@ -137,6 +281,14 @@ public:
 	**/
 	void write_solution(std::ostream& solution_file);
 
+	/**
+	 * \brief Writes the problem instance in the binary format on the output stream.
+	 * \param instance_file the stream linked to the file where writing the instance (opened in binary mode).
+	 *
+	 * \see binary_instance
+	**/
+	void write_instance(std::ostream& instance_file);
+
 	/**
 	 * \brief Performs some feasibility tests and reports the result.
 	 * \return verdict of the test.
@@ -148,8 +300,16 @@ private:
 	/** \brief Data structure containing all the relevant information read from the input file. **/
 	struct input_problem {
 
-		/** \brief costs to move a user of the given type from one cell to another in the specified time period. **/
-		multi_array<double, 4> costs;
+		/**
+		 * \brief costs to move a user of the given type from one cell to another in the specified time period.
+		 *
+		 * The matrix is accessed as usual through {i, j, m, t} indexes, but it is stored in memory
+		 * according to the {j, m, i, t} layout: in this way the costs of all the users of a given type
+		 * which can reach a given destination cell (i.e. the ones scanned when building costs_order)
+		 * are stored contiguously. Being the largest data structure, it is also aligned and backed
+		 * by huge pages where possible.
+		**/
+		costs_matrix_type costs;
 
 		/** \brief number of users available for each source cell, customer type and time period. **/
 		multi_array<int, 3> users_available;
@@ -171,7 +331,8 @@ private:
 		 * \param n_time_steps number of different time periods.
 		**/
 		input_problem(const size_type& n_cells, const size_type& n_cust_types, const size_type& n_time_steps)
-			: costs({n_cells, n_cells, n_cust_types, n_time_steps}), users_available({n_cells, n_cust_types, n_time_steps}) {
+			: costs({n_cells, n_cells, n_cust_types, n_time_steps}, {four_index::j, four_index::m, four_index::i, four_index::t}),
+				users_available({n_cells, n_cust_types, n_time_steps}) {
 				act_per_user = new int[n_cust_types];
 				activities = new int[n_cells];
 		}
@@ -191,18 +352,21 @@ private:
 		/** \brief number of different customer types. **/
 		const size_type n_cust_types;
 
+		/** \brief encoder used to pack the groups of users stored inside costs_order. **/
+		const packed_source sources;
+
 		/**
-		 * \brief matrix providing access to ordered costs.
+		 * \brief array providing access to ordered costs.
 		 *
-		 * This matrix stores for each customers type (first index)
-		 * and destination cell (second index) an array of indexes sorted
-		 * by not-decreasing cost order.
+		 * This array stores for each destination cell the lists of packed
+		 * indexes (see sources) of each customers type sorted by not-decreasing
+		 * cost order, which are merged according to the reduced costs.
 		 *
-		 * \see get_costs_idx()
+		 * \see get_max_done()
 		 * \see initialization_phase()
-		 * \see coiote_solver::cmp_costs_asc
+		 * \see cells_order::get_least_expensive()
 		**/
-		cells_order** costs_order;
+		cells_order* costs_order;
 
 		/** \brief number of activities each user type is able to perform sorted in not-increasing order. **/
 		int* act_per_user_sorted;
@@ -213,6 +377,10 @@ private:
 		/** \brief maximum number of activities to be done. **/
 		int max_activities;
 
+		/** \brief lower bound of the objective function value (no solution can be cheaper).
+		 * It is raised by bound_body() while the threads are searching for a solution. **/
+		std::atomic<objective_type> lower_bound;
+
 		/** \brief slots of activities, computed and used only in case
 		 * of instances with few users. **/
 		activities_slots* act_slots;
@@ -228,11 +396,11 @@ private:
 		 * \param n_time_steps number of different time periods.
 		**/
 		global_statistics(const size_type& n_cells, const size_type& n_cust_types, const size_type& n_time_steps)
-			: n_cust_types(n_cust_types) {
+			: n_cust_types(n_cust_types), sources(n_cust_types, n_time_steps) {
 				act_per_user_sorted = new int[n_cust_types];
-				costs_order = new cells_order*[n_cust_types];
-				for(size_type i = 0; i < n_cust_types; i++)
-					costs_order[i] = new cells_order[n_cells];
+				costs_order = new cells_order[n_cells];
+				for(size_type j = 0; j < n_cells; j++)
+					costs_order[j].initialize(n_cust_types);
 				act_slots = nullptr;
 		}
 
@@ -240,64 +408,115 @@ private:
 		 * \brief Destructor.
 		**/
 		~global_statistics() {
-			for(size_type i = 0; i < n_cust_types; i++)
-				delete[](costs_order[i]);
 			delete[](costs_order);
 			delete[](act_per_user_sorted);
 			delete(act_slots);
 		}
 
 		/**
-		 * \brief Computes the index to be used for the first dimension of the costs_order matrix.
+		 * \brief Computes the limit to be used to compute the reduced costs when iterating through costs_order.
 		 *
-		 * The index is computed by considering the remaining demand to be satisfied in the
-		 * current destination cell, and retrieving the one referring the order relative to the
-		 * users type able to do the maximum number of activities not exceeding the demand.
+		 * The limit is computed by considering the remaining demand to be satisfied in the
+		 * current destination cell, and retrieving the maximum number of activities not exceeding
+		 * the demand that a users type is able to do (or the minimum one if all exceed it).
 		 *
-		 * Be careful that this does not mean that the given order contains only users belonging
-		 * to that type, but it implies that the reduced costs are computed considering at most
+		 * Be careful that this does not mean that only users belonging to that type are
+		 * considered, but it implies that the reduced costs are computed considering at most
 		 * that number of activities to be done.
 		 *
 		 * \param demand remaining demand in the current cell.
 		**/
-		inline unsigned get_costs_idx(const int demand) {
+		inline int get_max_done(const int demand) {
 			unsigned m = 0;
 			while(act_per_user_sorted[m] > demand && m < n_cust_types-1)
 				++m;
-			return m;
+			return act_per_user_sorted[m];
 		}
 	};
 
+	struct search_data;
+	class numa_replica;
 	struct moves_statistics;
 	struct improved_move;
 	struct th_parameter;
 	struct ti_parameter;
 	class cells_usage;
 	class cmp_costs_desc;
-	class cmp_costs_asc;
 
 
 	const size_type n_cells; /**< \brief The number of cells in the current instance file. **/
 	const size_type n_time_steps; /**< \brief The number of different time periods. **/
 	const size_type n_cust_types; /**< \brief The number of different types of customers. **/
 
+	/** \brief The parameters tuning the behavior of the solver. **/
+	const settings config;
+
 	input_problem problem; /**< \brief Input data relative to the current instance file. **/
 	global_statistics statistics; /**< \brief Statistics relative to the current instance file. **/
 
 	/** \brief A boolean variable specifying whether a feasible solution has been found or not. **/
 	bool has_solution;
 
-	/** \brief Multi-dimensional array used to store the best solution found. **/
-	multi_array<int, 4> solution;
+	/** \brief Sparse multi-dimensional array used to store the best solution found. **/
+	sparse_solution solution;
 
 	/** \brief Vector containing some KPIs relative to the best solution found. **/
 	std::vector<double> kpi;
 
+	/** \brief Cells whose demand has become (or ceased to be) positive since the cost-based orders have been computed. **/
+	std::vector<size_type> changed_cells;
+	/** \brief Groups of users (packed indexes) which have become available or unavailable since the cost-based
+	 * orders have been computed (a group changed an even number of times is eventually unchanged). **/
+	std::vector<packed_source::value_type> changed_sources;
+
+	/** \brief Objective function value of the best solution found so far by any thread.
+	 * It is updated without locks through publish_incumbent(). **/
+	std::atomic<objective_type> incumbent;
+
+	/** \brief Number of threads still searching for a solution. **/
+	std::atomic<unsigned> running_threads;
+
 	/** \brief A flag set to true when the time available to generate the solution is finished. **/
 	volatile bool time_finished;
 	/** \brief A flag set to true when the time available to generate the solution is finished,
 	 * used in the case of instances with a very limited amount of users **/
 	volatile bool fewusers_time_finished;
+	/** \brief A flag set to true when any thread enters the 'few users' mode, hence the search
+	 * goes on until fewusers_time_finished is set. **/
+	std::atomic<bool> fewusers_mode;
+
+	/**
+	 * \brief Reads the problem instance (apart from its dimensions) from the instance file.
+	 * \param input the scanner linked to the instance file, positioned after the dimensions.
+	 * \throw parse_error if the instance file does not respect the expected format.
+	**/
+	void read_instance(text_scanner& input);
+
+	/**
+	 * \brief Copies the problem instance from an instance file stored in the binary format.
+	 * \param instance the instance file in the binary format.
+	**/
+	void copy_instance(const binary_instance& instance);
+
+	/**
+	 * \brief Discards the current solution and the statistics depending on the problem instance,
+	 * in order to be able to load a new one.
+	**/
+	void reset();
+
+	/**
+	 * \brief Reads the matrix of costs from the instance file.
+	 *
+	 * The section is composed of one block for each customer type and time period, each one
+	 * made of an header line and a row for each source cell. The lines are located through a
+	 * quick pre-scan and then parsed in parallel by config.n_load_threads threads, each one entitled to
+	 * fill the costs relative to a different range of source cells. In case the layout
+	 * of the file is not the expected one, the section is parsed sequentially.
+	 *
+	 * \param input the scanner linked to the instance file, positioned at the beginning of the section.
+	 * \throw parse_error if the section does not respect the expected format.
+	**/
+	void read_costs(text_scanner& input);
 
 	/**
 	 * \brief Builds up the necessary statistics, in particular the cost ordering through
@@ -306,18 +525,28 @@ private:
 	void initialization_phase();
 
 	/**
-	 * \brief Computes the cost ordering for the given user type.
+	 * \brief Function executed by the threads building up the cost orderings.
+	 *
+	 * Each list of costs_order (i.e. each pair of destination cell and user type) is a
+	 * separate task: the threads repeatedly pick the next task not yet assigned until all of them
+	 * have been completed, so that the work is balanced independently of the number of user types.
+	 *
+	 * \param next_task counter shared by all the threads storing the next task to be assigned.
+	**/
+	void initialization_worker(std::atomic<size_type>* next_task);
+
+	/**
+	 * \brief Computes the cost ordering for the given user type and destination cell.
 	 *
-	 * The ordering is done according to the cmp_costs_asc comparator, in particular the costs
-	 * to be sorted are reduced by a factor which is the minimum between the number of activities
-	 * the given user type can do and a limit corresponding to the number of tasks the user
-	 * type specified as parameter is able to perform. Such a limit, and in particular the
-	 * computation of different orders, is done to be able to consider the correct sequence also
-	 * when only few activities have to be performed.
+	 * The ordering is done according to the cost_list::sort method. The reduced costs, which
+	 * depend on a limit to the number of activities to be considered (in order to get the correct
+	 * sequence also when only few activities have to be performed) are not computed here, since
+	 * the lists of the different user types are merged according to them only when iterating.
 	 *
-	 * \param index index of the limiting users type.
+	 * \param m user type.
+	 * \param j destination cell.
 	**/
-	void fill_cells_order(const size_type& index);
+	void fill_cells_order(const size_type& m, const size_type& j);
 
 	/**
 	 * \brief Tries to generate the solution.
@@ -335,6 +564,65 @@ private:
 	void thread_body(th_parameter* const param);
 
 
+	/**
+	 * \brief Monitors the convergence of the search, stopping it as soon as it is not worth continuing.
+	 *
+	 * The incumbent is sampled periodically until all the threads have terminated, and the rate of
+	 * improvement is estimated over a window equal to half of the elapsed time. The search is stopped
+	 * (as if the time were finished) when the gain expected in the remaining time at that rate is lower
+	 * than the fraction config.stop_gain of the incumbent (the remaining time is computed according to the
+	 * deadline of the mode in effect, see fewusers_mode), or when the gap between the incumbent and the
+	 * lower bound is not greater than the fraction config.gap_tolerance of the incumbent.
+	 *
+	 * \param start_time instant when the solution of the problem has started.
+	 * \param normal_limit time available in the case of a 'standard' instance, in seconds.
+	 * \param fewusers_limit time available in the case of a 'few users' instance, in seconds.
+	**/
+	void monitor_convergence(const std::chrono::steady_clock::time_point& start_time,
+		const double normal_limit, const double fewusers_limit);
+
+	/**
+	 * \brief Computes a lower bound of the objective function value.
+	 *
+	 * Each activity of a cell costs at least as the cheapest ratio between the cost of a user
+	 * and the number of activities it is able to perform, which is found at the beginning of
+	 * the cost-based orders (see cheapest_ratio()). Availability is not considered, hence the
+	 * bound is quite weak.
+	 *
+	 * \return the lower bound.
+	**/
+	objective_type compute_lower_bound() const;
+
+	/**
+	 * \brief Returns the cheapest ratio between the cost of a user and the number of activities it
+	 * is able to perform, among all the users which can reach a cell.
+	 * \param j destination cell.
+	 * \return the ratio, or zero if no user can reach the cell.
+	**/
+	double cheapest_ratio(const size_type& j) const;
+
+	/**
+	 * \brief Raises the lower bound through a Lagrangian relaxation, while the threads are searching.
+	 *
+	 * The demand constraints are relaxed with a multiplier for each cell, hence the problem decomposes
+	 * over the groups of users (i, m, t): all the users of a group are moved to the cell with the most
+	 * negative reduced cost (c_ijmt - multiplier_j * act_per_user_m), if any. The multipliers start
+	 * from the cheapest ratios of the cells (giving compute_lower_bound()) and are updated through
+	 * subgradient steps of Polyak type, using the incumbent as the upper bound. The best bound found
+	 * is stored in global_statistics::lower_bound.
+	 *
+	 * The method ends after a limited number of iterations, when the steps become negligible or
+	 * as soon as all the threads have terminated. It is executed only if config.lagrangian_bound
+	 * is set or config.gap_tolerance is positive.
+	**/
+	void bound_body();
+
+	/**
+	 * \brief Publishes a new solution found by a thread, updating the incumbent if it is better.
+	 * \param obj_function objective function value of the solution found.
+	**/
+	void publish_incumbent(const objective_type obj_function);
+
 	/**
 	 * \brief Greedy function which is the core of the solution generation.
 	 *
@@ -343,19 +631,47 @@ private:
 	 * satisfying the tasks of each one using the most convenient users (considering the reduced
 	 * costs) at the given moment.
 	 *
+	 * \param data the instance data to be read.
 	 * \param solution the data structure where the constructed solution is memorized. It is
-	 * reset at the beginning of the method.
+	 * cleared at the beginning of the method.
 	 * \param users_available the data structure updated after each step and used to memorize
-	 * the users still available. It is reset at the beginning of the method and it is passed
-	 * as parameter, even if used only locally, in order to avoid multiple costly allocations.
+	 * the users still available. It is restored at the beginning of the method (only the elements
+	 * modified by the previous execution are copied back) and it is passed as parameter, even if
+	 * used only locally, in order to avoid multiple costly allocations.
 	 * \param order order to be followed to visit the destination cells and satisfy the activities.
 	 * \param usage a sort of picture of the previous invocations of this method, in particular
 	 * related to the most often chosen groups of users.
+	 * \param abort_above the construction is aborted as soon as its partial objective function
+	 * value exceeds this threshold (no_solution to never abort it).
 	 * \return the objective function value relative to the current solution. It is equal to
-	 * std::numeric_limits<double>::infinity() in the case no solution is found.
+	 * no_solution in the case no solution is found, and to aborted_solution in the case the
+	 * construction has been aborted because its partial objective function value already
+	 * exceeded the threshold.
 	**/
-	double greedy(multi_array<int, 4>& solution, multi_array<int, 3>& users_available,
-		const std::vector<size_type>& order, cells_usage& usage);
+	objective_type greedy(const search_data& data, sparse_solution& solution, tracked_array<int, 3>& users_available,
+		const std::vector<size_type>& order, cells_usage& usage, const objective_type abort_above);
+
+	/**
+	 * \brief Satisfies the demand of a single cell, which is the step the greedy function is composed of.
+	 *
+	 * The cell is satisfied using the most convenient users (considering the reduced costs) among
+	 * the available ones, and then the most expensive users are removed if more activities than
+	 * necessary are done.
+	 *
+	 * \param data the instance data to be read.
+	 * \param j the destination cell.
+	 * \param demand the number of activities still to be done in the cell.
+	 * \param solution the solution to which the moves are added.
+	 * \param users_available the users still available, updated according to the moves.
+	 * \param usage a sort of picture of the previous choices (see greedy()).
+	 * \param inserted_indexes support vector storing the moves added (passed to avoid allocations).
+	 * \param first_available support vector with one element per user type (passed to avoid allocations).
+	 * \param positions support vector with one element per user type (passed to avoid allocations).
+	 * \return the increase of the objective function value, or no_solution if the available users are not enough.
+	**/
+	objective_type satisfy_demand(const search_data& data, const size_type j, int demand,
+		sparse_solution& solution, tracked_array<int, 3>& users_available, cells_usage& usage, vector_moves_type& inserted_indexes,
+		std::vector<size_type>& first_available, std::vector<size_type>& positions);
 
 	/**
 	 * \brief Modified version of the greedy function, used in the case of instances
@@ -369,21 +685,53 @@ private:
 	 * only few users in surplus. In the second one, on the other hand, this additional constraint
 	 * is relaxed hoping to be able to conclude the remaining activities.
 	 *
+	 * \param data the instance data to be read.
 	 * \param solution the data structure where the constructed solution is memorized. It is
-	 * reset at the beginning of the method.
+	 * cleared at the beginning of the method.
 	 * \param users_available the data structure updated after each step and used to memorize
-	 * the users still available. It is reset at the beginning of the method and it is passed
-	 * as parameter, even if used only locally, in order to avoid multiple costly allocations.
+	 * the users still available. It is restored at the beginning of the method (only the elements
+	 * modified by the previous execution are copied back) and it is passed as parameter, even if
+	 * used only locally, in order to avoid multiple costly allocations.
 	 * \param order order to be followed to visit the destination cells and satisfy the activities.
-	 * \param usage a sort of picture of the previous invocations of this method, in particular
-	 * related to the most often chosen groups of users.
+	 * \param usage not used, since the users are chosen only according to their costs (it is required
+	 * in order for the method to have the same type of greedy()).
+	 * \param abort_above the construction is aborted as soon as its partial objective function
+	 * value exceeds this threshold (no_solution to never abort it).
 	 * \return the objective function value relative to the current solution. It is equal to
-	 * std::numeric_limits<double>::infinity() in the case no solution is found.
+	 * no_solution in the case no solution is found, and to aborted_solution in the case the
+	 * construction has been aborted because its partial objective function value already
+	 * exceeded the threshold.
 	 *
 	 * \see greedy()
 	**/
-	double greedy_few_users(multi_array<int, 4>& solution, multi_array<int, 3>& users_available,
-		const std::vector<size_type>& order, cells_usage& usage);
+	objective_type greedy_few_users(const search_data& data, sparse_solution& solution, tracked_array<int, 3>& users_available,
+		const std::vector<size_type>& order, cells_usage& usage, const objective_type abort_above);
+
+	/**
+	 * \brief Computes again the statistics affected by the changes made to the instance since
+	 * the last computation (see changed_cells and changed_sources).
+	**/
+	void refresh_statistics();
+
+	/**
+	 * \brief Repairs a solution which has become not feasible because of the changes made to the instance.
+	 *
+	 * The users exceeding the new availability (the most expensive ones) and the ones in excess with
+	 * respect to the new demand are removed, then the remaining demand of each cell is satisfied
+	 * through satisfy_demand().
+	 *
+	 * \param data the instance data to be read.
+	 * \param solution the solution to be repaired.
+	 * \return the objective function value of the repaired solution, or no_solution if it cannot be repaired.
+	**/
+	objective_type repair(const search_data& data, sparse_solution& solution);
+
+	/**
+	 * \brief Stores the KPIs relative to the current solution, including its gap from the lower bound.
+	 * \param obj_function objective function value of the solution.
+	 * \param elapsed time spent to find the solution, in seconds.
+	**/
+	void store_kpi(const objective_type obj_function, const double elapsed);
 
 	/**
 	 * \brief Tries to improve the current solution.
@@ -391,18 +739,20 @@ private:
 	 * This method is entitled to generate the necessary statistics and to apply the
 	 * try_improve method to the different moves composing the solution.
 	 *
+	 * \param data the instance data to be read.
 	 * \param solution current solution to try to improve.
 	 * \return objective function value gain obtained.
 	**/
-	double improving_phase(multi_array<int, 4>& solution);
+	objective_type improving_phase(const search_data& data, sparse_solution& solution);
 
 	/**
 	 * \brief Computes the moves statistics starting from a solution already generated in order to
 	 * be able to apply the try_improve method to improve it.
+	 * \param data the instance data to be read.
 	 * \param solution the solution to be improved and used to generate the statistics.
 	 * \return the generated data structure.
 	**/
-	moves_statistics improving_setup(multi_array<int, 4>& solution);
+	moves_statistics improving_setup(const search_data& data, sparse_solution& solution);
 
 	/**
 	 * \brief Recursive function which tries to improve the current solution.
@@ -417,13 +767,14 @@ private:
 	 * hand, the method checks whether is possible to replace some other activities done by
 	 * the chosen users in other destination cells through a recursive call of the function.
 	 *
+	 * \param data the instance data to be read.
 	 * \param solution current solution to be improved.
 	 * \param param a series of information necessary for the current iteration (in particular
 	 * which element of the solution has to be modified and how many users have to be removed).
 	 * \param statistics_moves statistics related to the current solution.
 	 * \return a boolean value indicating whether the process outcome is positive or not.
 	**/
-	bool try_improve(multi_array<int, 4>& solution, ti_parameter& param, moves_statistics& statistics_moves);
+	bool try_improve(const search_data& data, sparse_solution& solution, ti_parameter& param, moves_statistics& statistics_moves);
 
 	/**
 	 * \brief Checks whether one or more users may be removed.
@@ -432,13 +783,14 @@ private:
 	 * some changes, more activities than necessary are done. In this case the
 	 * most expensive users (compatibly with the constraints) are removed.
 	 *
+	 * \param data the instance data to be read.
 	 * \param j destination cell to be checked.
 	 * \param solution current solution.
 	 * \param statistics_moves data structures containing information related to the solution.
 	 * \param moves array where the changes done will be recorded.
 	 * \return objective function gain due to the changes.
 	**/
-	double get_removable(const size_type j, multi_array<int, 4>& solution, moves_statistics& statistics_moves, std::vector<improved_move>& moves);
+	objective_type get_removable(const search_data& data, const size_type j, sparse_solution& solution, moves_statistics& statistics_moves, std::vector<improved_move>& moves);
 
 	/**
 	 * \brief Does or undoes a move decided by the try_improve method.
@@ -448,7 +800,7 @@ private:
 	 * \param undo flag which is true if the move has to be undone.
 	 * \return a value to be added to the current objective function value to reflect the modification.
 	**/
-	double add_remove_user(const improved_move& ic, multi_array<int, 4>& solution, moves_statistics& statistics_moves, const bool undo);
+	objective_type add_remove_user(const improved_move& ic, sparse_solution& solution, moves_statistics& statistics_moves, const bool undo);
 };
 
 /** \brief Data structure containing different information about which groups of users have been moved
@@ -487,7 +839,7 @@ struct coiote_solver::improved_move {
 	four_index_type f_idx; /**< \brief Index of the modified cell (four dimensional) **/
 	int user_added; /**< \brief Number of added (or removed) users. **/
 	int activities_added; /**< \brief Number of added (or removed) activities. **/
-	double obj_gain; /**< \brief Gain (or loss) obtained through this move. **/
+	objective_type obj_gain; /**< \brief Gain (or loss) obtained through this move. **/
 
 	/**
 	 * \brief Constructor.
@@ -500,15 +852,61 @@ struct coiote_solver::improved_move {
 	 * \param obj_gain gain (or loss) obtained through this move.
 	**/
 	improved_move(const size_type& i, const size_type& j, const size_type& m, const size_type& t,
-		const int user_added, const int activities_added, const double obj_gain)
+		const int user_added, const int activities_added, const objective_type obj_gain)
 		: t_idx({i,m,t}), f_idx({i,j,m,t}), user_added(user_added),
 			activities_added(activities_added), obj_gain(obj_gain) {}
 };
 
+/** \brief Data structure referring to the read-only instance data accessed by the threads while
+ * searching for solutions: either the data shared by all of them or a replica local to a NUMA node. **/
+struct coiote_solver::search_data {
+	const costs_matrix_type* costs; /**< \brief Costs of the moves (see input_problem::costs). **/
+	const multi_array<int, 3>* users_available; /**< \brief Users available (see input_problem::users_available). **/
+	const cells_order* costs_order; /**< \brief Ordered costs (see global_statistics::costs_order). **/
+};
+
+/**
+ * \brief Class storing a copy of the read-only instance data accessed by the threads while searching
+ * for solutions, to be used by the threads running on a given NUMA node.
+ *
+ * The object is expected to be constructed by a thread running on the desired node: since the memory
+ * is placed on the node of the thread touching it first, the copy is then local to that node.
+**/
+class coiote_solver::numa_replica {
+public:
+	/**
+	 * \brief Constructor. Copies the data shared by all the threads.
+	 * \param problem the instance data.
+	 * \param statistics the statistics computed starting from the instance data.
+	 * \param n_cells number of cells.
+	**/
+	numa_replica(const input_problem& problem, const global_statistics& statistics, const size_type& n_cells)
+		: costs(problem.costs), users_available(problem.users_available), costs_order(new cells_order[n_cells]) {
+			for(size_type j = 0; j < n_cells; j++)
+				costs_order[j].assign(statistics.costs_order[j]);
+	}
+
+	/**
+	 * \brief Destructor.
+	**/
+	~numa_replica() { delete[](costs_order); }
+
+	/**
+	 * \brief Returns the structure referring to the data stored in the replica.
+	 * \return the structure referring to the data.
+	**/
+	inline search_data data() const { return { &costs, &users_available, costs_order }; }
+
+private:
+	costs_matrix_type costs; /**< \brief Copy of the costs of the moves. **/
+	multi_array<int, 3> users_available; /**< \brief Copy of the users available. **/
+	cells_order* costs_order; /**< \brief Copy of the ordered costs. **/
+};
+
 /** \brief Data structure used as a parameter for the function thread_body. **/
 struct coiote_solver::th_parameter {
-	multi_array<int, 4> solution; /**< \brief Best solution found so far. **/
-	double obj_function; /**< \brief Value of the objective function relative to the best solution found so far. **/
+	sparse_solution solution; /**< \brief Best solution found so far. **/
+	objective_type obj_function; /**< \brief Value of the objective function relative to the best solution found so far. **/
 	std::mt19937 rndgen; /**< \brief Random genarator unique for each thread_body execution. **/
 	size_type iterations; /**< \brief Number of iterations done during the thread body execution. **/
 
@@ -516,6 +914,12 @@ struct coiote_solver::th_parameter {
 	const three_index_type three_dimensions;
 	/** \brief Dimensions of the problem used to build four dimensional arrays. **/
 	const four_index_type four_dimensions;
+	/** \brief Instance data to be read by the thread. **/
+	const search_data data;
+	/** \brief Topology used to pin the thread to a CPU, before it allocates its data (nullptr if not pinned). **/
+	const cpu_topology* topology;
+	/** \brief Index of the thread, used to choose the CPU it is pinned to. **/
+	const size_type index;
 
 	/**
 	 * \brief Constructor.
@@ -523,10 +927,14 @@ struct coiote_solver::th_parameter {
 	 * \param seed seed for the random generator.
 	 * \param t_dim dimensions of the problem used to build three dimensional arrays.
 	 * \param f_dim dimensions of the problem used to build four dimensional arrays.
+	 * \param data instance data to be read by the thread.
+	 * \param topology topology used to pin the thread (nullptr if it must not be pinned).
+	 * \param index index of the thread.
 	**/
-	th_parameter(const unsigned seed, const three_index_type& t_dim, const four_index_type& f_dim)
-		: solution(f_dim), obj_function(std::numeric_limits<double>::infinity()),
-			rndgen(seed), iterations(0), three_dimensions(t_dim), four_dimensions(f_dim) {}
+	th_parameter(const unsigned seed, const three_index_type& t_dim, const four_index_type& f_dim, const search_data& data,
+		const cpu_topology* topology, const size_type index)
+		: solution(f_dim), obj_function(no_solution), rndgen(seed), iterations(0),
+			three_dimensions(t_dim), four_dimensions(f_dim), data(data), topology(topology), index(index) {}
 };
 
 /** \brief Data structure used as a parameter for the function try_improve. **/
@@ -535,7 +943,7 @@ struct coiote_solver::ti_parameter {
 	const four_index_type curr_idx; /**< \brief Cell considered by the current iteration. **/
 	const int users_to_remove; /**< \brief Number of users to be removed. **/
 
-	double obj_gain_so_far; /**< \brief Gain of the objective function value so far. **/
+	objective_type obj_gain_so_far; /**< \brief Gain of the objective function value so far. **/
 	std::vector<coiote_solver::improved_move> imp_moves; /**< \brief List of moves already done. **/
 	std::vector<four_index_type> considered_cells; /**< \brief List of tabu cells. **/
 
@@ -589,22 +997,22 @@ public:
 
 	/**
 	 * \brief Adds the information into the statistic.
-	 * \param idx index of the users added.
+	 * \param src packed index of the users added.
 	 * \param nusers number of users added.
 	**/
-	inline void add(const three_index_type& idx, unsigned nusers) {
-		usage[idx] += ((double)nusers/users_available[idx]);
+	inline void add(const packed_source::value_type& src, unsigned nusers) {
+		usage.begin()[src] += ((double)nusers/users_available.begin()[src]);
 	}
 
 	/**
 	 * \brief Compares two groups of users and returns which one may be the best to be chosen.
-	 * \param new_idx users group which is available to replace the other one.
-	 * \param old_idx previously chosen users group.
+	 * \param new_src packed index of the users group which is available to replace the other one.
+	 * \param old_src packed index of the previously chosen users group.
 	 * \return a boolean parameter equal to true if it could be better to replace the previously
 	 * chosen users group.
 	**/
-	inline bool should_replace(const three_index_type& new_idx, const three_index_type& old_idx) {
-		return (usage[new_idx] < usage[old_idx]);
+	inline bool should_replace(const packed_source::value_type& new_src, const packed_source::value_type& old_src) {
+		return (usage.begin()[new_src] < usage.begin()[old_src]);
 	}
 
 private:
@@ -626,7 +1034,7 @@ public:
 	 * \param costs reference to the structure containing the costs of each move,
 	 * which is saved to be able to perform the comparison.
 	**/
-	cmp_costs_desc(const multi_array<double, 4>& costs) : costs(costs) {}
+	cmp_costs_desc(const costs_matrix_type& costs) : costs(costs) {}
 
 	/**
 	 * \brief Returns whether its first argument compares less than the second
@@ -640,55 +1048,7 @@ public:
 	}
 private:
 	/** \brief Reference to the structure containing the costs of each move. **/
-	const multi_array<double, 4>& costs;
-};
-
-/**
- * \brief Comparator used to order the indexes according to not-decreasing costs.
- *
- * The ordering is done considering the costs to be sorted as reduced by a factor
- * which is the minimum between the number of activities the given users type can
- * do and a limit specified as a parameter of the constructor.
- * Such a limit and in particular the computation of different orders with
- * different limits is done to be able to consider the correct sequence also
- * when only few activities have to be performed.
-**/
-class coiote_solver::cmp_costs_asc {
-public:
-	/**
-	 * \brief Constructor.
-	 * \param costs reference to the structure containing the costs of each move,
-	 * which is saved to be able to perform the comparison.
-	 * \param act_per_user array containing the number of activities each type of
-	 * users is able to perform.
-	 * \param max_done maximum number of the activities each user type is allowed
-	 * to do. This is an additional constraint not related to the characteristics of
-	 * the users but used to compute different orders as explained in the description
-	 * of this class.
-	**/
-	cmp_costs_asc(const multi_array<double, 4>& costs, const int* act_per_user, const int max_done)
-		: costs(costs), act_per_user(act_per_user), max_done(max_done) {}
-
-	/**
-	 * \brief Returns whether its first argument compares less than the second
-	 * according to the not-decreasing reduced cost order.
-	 * \param lhs first argument.
-	 * \param rhs second argument.
-	 * \return comparison result.
-	**/
-	bool operator()(const four_index_type& lhs, const four_index_type& rhs) const {
-		return ((costs[lhs]/std::min(act_per_user[lhs[four_index::m]], max_done))
-				< (costs[rhs]/std::min(act_per_user[rhs[four_index::m]], max_done)));
-	}
-private:
-	/** \brief Reference to the structure containing the costs of each move. **/
-	const multi_array<double, 4>& costs;
-
-	/** \brief Number of activities each type of users is able to perform. **/
-	const int* act_per_user;
-
-	/** \brief Maximum number of activities each type of users is allowed to perform. **/
-	const int max_done;
+	const costs_matrix_type& costs;
 };
 
 
@@ -14,54 +14,230 @@
 // along with CoIoTeSolver. If not, see <http://www.gnu.org/licenses/>.
 
 
-#include <cmath>
+#include <algorithm>
+#include <exception>
 #include <iostream>
 #include <string>
+#include <thread>
+#include <tuple>
 
 #include "coiote_solver.h"
 
-coiote_solver::coiote_solver(std::istream& input_file, const size_type& n_cells, const size_type& n_timesteps, const size_type& n_custtypes) :
-	n_cells(n_cells), n_time_steps(n_timesteps), n_cust_types(n_custtypes),
+coiote_solver::coiote_solver(text_scanner& input, const size_type& n_cells, const size_type& n_timesteps,
+	const size_type& n_custtypes, const settings& config) :
+	n_cells(n_cells), n_time_steps(n_timesteps), n_cust_types(n_custtypes), config(config),
 	problem(n_cells, n_custtypes, n_timesteps), statistics(n_cells, n_custtypes, n_timesteps),
 	has_solution(false), solution({ n_cells, n_cells, n_cust_types, n_time_steps }),
 	time_finished(false), fewusers_time_finished(false) {
 
+	read_instance(input);
+}
+
+coiote_solver::coiote_solver(const binary_instance& instance, const settings& config) :
+	n_cells(instance.n_cells()), n_time_steps(instance.n_time_steps()), n_cust_types(instance.n_cust_types()), config(config),
+	problem(n_cells, n_cust_types, n_time_steps), statistics(n_cells, n_cust_types, n_time_steps),
+	has_solution(false), solution({ n_cells, n_cells, n_cust_types, n_time_steps }),
+	time_finished(false), fewusers_time_finished(false) {
+
+	copy_instance(instance);
+}
+
+bool coiote_solver::reload(text_scanner& input, const size_type& n_cells, const size_type& n_timesteps,
+	const size_type& n_custtypes) {
+
+	if(n_cells != this->n_cells || n_timesteps != n_time_steps || n_custtypes != n_cust_types)
+		return false;
+
+	reset();
+	read_instance(input);
+	return true;
+}
+
+bool coiote_solver::reload(const binary_instance& instance) {
+	if(instance.n_cells() != n_cells || instance.n_time_steps() != n_time_steps || instance.n_cust_types() != n_cust_types)
+		return false;
+
+	reset();
+	copy_instance(instance);
+	return true;
+}
+
+void coiote_solver::reset() {
+	has_solution = false;
+	solution.clear();
+	kpi.clear();
+	changed_cells.clear();
+	changed_sources.clear();
+
+	// The slots depend on the activities of the instance, hence they will be computed again if needed
+	delete(statistics.act_slots);
+	statistics.act_slots = nullptr;
+}
+
+void coiote_solver::read_instance(text_scanner& input) {
 	// Read the number of activities done by each type of user
 	for(size_type  m = 0; m < n_cust_types; m++) {
-		input_file >> problem.act_per_user[m];;
+		problem.act_per_user[m] = input.read_int();
 	}
 
 	// Read the matrix of costs
-	unsigned tmp_i; std::string tmp_s;
+	read_costs(input);
+
+	// Read the activities to be done
+	for(size_type i = 0; i < n_cells; i++) {
+		problem.activities[i] = input.read_int();
+	}
+
+	// Read the number of users for each type and time step
 	for(size_type m = 0; m < n_cust_types; m++) {
 		for(size_type t = 0; t < n_time_steps; t++) {
-			input_file >> tmp_i; // Read m index (useless)
-			input_file >> tmp_i; // Read t index (useless)
+			input.read_int(); // Read m index (useless)
+			input.read_int(); // Read t index (useless)
 			for(size_type i = 0; i < n_cells; i++)
-				for(size_type j = 0; j < n_cells; j++) {
-					// Read the costs as strings and then convert them into integer
-					input_file >> tmp_s;
-					problem.costs[{i,j,m,t}] = std::stoi(tmp_s);
-				}
+				problem.users_available[{i,m,t}] = input.read_int();
 		}
 	}
+}
 
-	// Read the activities to be done
-	for(size_type i = 0; i < n_cells; i++) {
-		input_file >> problem.activities[i];
+void coiote_solver::read_costs(text_scanner& input) {
+	// Position of a line inside the instance file
+	struct text_line {
+		const char* begin;
+		const char* end;
+		size_type number;
+	};
+
+	const size_type n_threads = config.n_load_threads;
+	const size_type n_blocks = n_cust_types*n_time_steps;
+	const size_type n_lines = n_blocks*(n_cells+1);
+
+	// Pre-scan the section, collecting the position of each line (one header and n_cells rows per block)
+	text_scanner prescan = input;
+	std::vector<text_line> lines(n_lines);
+	bool layout_ok = (n_threads > 1);
+	for(size_type a = 0; a < n_lines && layout_ok; a++) {
+		layout_ok = prescan.skip_line(lines[a].begin, lines[a].end, lines[a].number);
 	}
 
-	// Read the number of users for each type and time step
+	if(layout_ok) {
+		std::vector<std::exception_ptr> errors(n_threads);
+		std::vector<std::thread> threads;
+
+		// Each thread parses, for all the blocks, the rows relative to a different range of source cells
+		for(size_type th = 0; th < n_threads; th++) {
+			const size_type first = n_cells*th/n_threads, last = n_cells*(th+1)/n_threads;
+			threads.push_back(std::thread([this, &lines, &errors, th, first, last]() {
+				try {
+					for(size_type m = 0; m < n_cust_types; m++)
+						for(size_type t = 0; t < n_time_steps; t++) {
+							const text_line* block = &lines[(m*n_time_steps + t)*(n_cells+1)];
+
+							// The header line is checked by the first thread (m and t indexes are useless)
+							if(th == 0) {
+								text_scanner header(block[0].begin, block[0].end, block[0].number);
+								header.read_int();
+								header.read_int();
+								header.expect_end();
+							}
+
+							for(size_type i = first; i < last; i++) {
+								text_scanner row(block[i+1].begin, block[i+1].end, block[i+1].number);
+								for(size_type j = 0; j < n_cells; j++)
+									problem.costs[{i,j,m,t}] = row.read_int();
+								row.expect_end();
+							}
+						}
+				}
+				catch(...) {
+					errors[th] = std::current_exception();
+				}
+			}));
+		}
+
+		for(size_type th = 0; th < n_threads; th++)
+			threads[th].join();
+
+		// If all the rows have been parsed correctly, the section is concluded
+		layout_ok = ((size_type)std::count(errors.begin(), errors.end(), nullptr) == n_threads);
+		if(layout_ok) {
+			input = prescan;
+			return;
+		}
+	}
+
+	// Otherwise parse the section sequentially (which also detects the correct position of any error)
 	for(size_type m = 0; m < n_cust_types; m++) {
 		for(size_type t = 0; t < n_time_steps; t++) {
-			input_file >> tmp_i; // Read m index (useless)
-			input_file >> tmp_i; // Read t index (useless)
+			input.read_int(); // Read m index (useless)
+			input.read_int(); // Read t index (useless)
 			for(size_type i = 0; i < n_cells; i++)
-				input_file >> problem.users_available[{i,m,t}];
+				for(size_type j = 0; j < n_cells; j++)
+					problem.costs[{i,j,m,t}] = input.read_int();
 		}
 	}
 }
 
+void coiote_solver::copy_instance(const binary_instance& instance) {
+	// Copy the number of activities done by each type of user
+	for(size_type m = 0; m < n_cust_types; m++) {
+		problem.act_per_user[m] = instance.act_per_user(m);
+	}
+
+	// Copy the matrix of costs
+	for(size_type m = 0; m < n_cust_types; m++)
+		for(size_type t = 0; t < n_time_steps; t++)
+			for(size_type i = 0; i < n_cells; i++)
+				for(size_type j = 0; j < n_cells; j++)
+					problem.costs[{i,j,m,t}] = instance.cost(m,t,i,j);
+
+	// Copy the activities to be done
+	for(size_type i = 0; i < n_cells; i++) {
+		problem.activities[i] = instance.activities(i);
+	}
+
+	// Copy the number of users for each type and time step
+	for(size_type m = 0; m < n_cust_types; m++)
+		for(size_type t = 0; t < n_time_steps; t++)
+			for(size_type i = 0; i < n_cells; i++)
+				problem.users_available[{i,m,t}] = instance.users_available(m,t,i);
+}
+
+void coiote_solver::write_instance(std::ostream& instance_file) {
+	binary_instance::write_header(instance_file, n_cells, n_time_steps, n_cust_types);
+
+	std::vector<char> buffer;
+	buffer.reserve(4*n_cells*n_cells);
+
+	// Write the number of activities done by each type of user
+	for(size_type m = 0; m < n_cust_types; m++)
+		binary_instance::append_int32(buffer, problem.act_per_user[m]);
+	instance_file.write(buffer.data(), buffer.size());
+
+	// Write the matrix of costs, one block for each user type and time step
+	for(size_type m = 0; m < n_cust_types; m++)
+		for(size_type t = 0; t < n_time_steps; t++) {
+			buffer.clear();
+			for(size_type i = 0; i < n_cells; i++)
+				for(size_type j = 0; j < n_cells; j++)
+					binary_instance::append_int32(buffer, problem.costs[{i,j,m,t}]);
+			instance_file.write(buffer.data(), buffer.size());
+		}
+
+	// Write the activities to be done
+	buffer.clear();
+	for(size_type i = 0; i < n_cells; i++)
+		binary_instance::append_int32(buffer, problem.activities[i]);
+	instance_file.write(buffer.data(), buffer.size());
+
+	// Write the number of users for each type and time step
+	buffer.clear();
+	for(size_type m = 0; m < n_cust_types; m++)
+		for(size_type t = 0; t < n_time_steps; t++)
+			for(size_type i = 0; i < n_cells; i++)
+				binary_instance::append_int32(buffer, problem.users_available[{i,m,t}]);
+	instance_file.write(buffer.data(), buffer.size());
+}
+
 void coiote_solver::write_kpi(std::ostream& output_file, const std::string& instance_name) {
 	if(!has_solution)
 		return;
@@ -77,12 +253,19 @@ void coiote_solver::write_solution(std::ostream& solution_file) {
 		return;
 
 	solution_file << n_cells << ";" << n_time_steps << ";" << n_cust_types << std::endl;
-	for(size_type m = 0; m < n_cust_types; m++)
-		for(size_type t = 0; t < n_time_steps; t++)
-			for(size_type i = 0; i < n_cells; i++)
-				for(size_type j = 0; j < n_cells; j++)
-					if(solution[{i,j,m,t}] > 0)
-						solution_file << i << ";" << j << ";" << m << ";" << t << ";" << solution[{i,j,m,t}] << std::endl;
+
+	// Sort the moves according to the (m, t, i, j) order of the output format
+	std::vector<sparse_solution::move> moves(solution.begin(), solution.end());
+	std::sort(moves.begin(), moves.end(), [](const sparse_solution::move& lhs, const sparse_solution::move& rhs) {
+		const four_index_type l = lhs.index, r = rhs.index;
+		return std::make_tuple(l[four_index::m], l[four_index::t], l[four_index::i], l[four_index::j]) <
+			std::make_tuple(r[four_index::m], r[four_index::t], r[four_index::i], r[four_index::j]);
+	});
+
+	for(std::vector<sparse_solution::move>::const_iterator it = moves.begin(); it != moves.end(); ++it)
+		if(it->users > 0)
+			solution_file << it->index[four_index::i] << ";" << it->index[four_index::j] << ";" << it->index[four_index::m]
+				<< ";" << it->index[four_index::t] << ";" << it->users << std::endl;
 }
 
 coiote_solver::feasibility_state coiote_solver::is_feasible() {
@@ -90,41 +273,42 @@ coiote_solver::feasibility_state coiote_solver::is_feasible() {
 	if(!has_solution)
 		return feasibility_state::NO_SOLUTION;
 
-	const double eps = 0.001;
-	const double objfun_value = kpi[0];
-	double objfun_verify = 0; int counter;
+	const objective_type objfun_value = (objective_type)kpi[0];
+	objective_type objfun_verify = 0;
+
+	std::vector<int> done_in_j(n_cells, 0); // Number of activities done in each destination cell
+	multi_array<int, 3> users_moved({ n_cells, n_cust_types, n_time_steps }); // Number of users moved for each (i, m, t)
+	users_moved.reset();
+	bool same_cell = false;
+
+	// Accumulate the activities done and the users moved, recomputing also the value of the objective function
+	for(sparse_solution::const_iterator it = solution.begin(); it != solution.end(); ++it) {
+		const four_index_type& idx = it->index;
+		size_type i = idx[four_index::i], j = idx[four_index::j], m = idx[four_index::m], t = idx[four_index::t];
+
+		done_in_j[j] += problem.act_per_user[m] * it->users;
+		users_moved[{i,m,t}] += it->users;
+		objfun_verify += (objective_type)it->users * problem.costs[idx];
+		// Check that no users do activities in their source cell
+		same_cell = same_cell || (i == j);
+	}
 
 	// Verify for each destination cell if the demand is satisfied
-	for(size_type j = 0; j < n_cells; j++) {
-		counter = 0;
-		for(size_type i = 0; i < n_cells; i++)
-			for(size_type m = 0; m < n_cust_types; m++)
-				for(size_type t = 0; t < n_time_steps; t++) {
-					counter += problem.act_per_user[m] * solution[{i,j,m,t}];
-					// Recompute also the value of the objective funciton
-					objfun_verify += solution[{i,j,m,t}] * problem.costs[{i,j,m,t}];
-				}
-		if(counter < problem.activities[j])
+	for(size_type j = 0; j < n_cells; j++)
+		if(done_in_j[j] < problem.activities[j])
 			return feasibility_state::NOT_FEASIBLE_DEMAND;
-	}
 
-	// Verify for each user type (i, m, t) that the number of users moved
-	// does not exceed the number of available ones
-	for(size_type i = 0; i < n_cells; i++)
-		for(size_type m = 0; m < n_cust_types; m++)
-			for(size_type t = 0; t < n_time_steps; t++) {
-				counter = 0;
-				for(size_type j = 0; j < n_cells; j++)
-					counter += solution[{i,j,m,t}];
-				if(counter > problem.users_available[{i,m,t}])
-					return feasibility_state::NOT_FEASIBLE_USERS;
-				// Check that no users do activities in their source cell
-				if(solution[{i,i,m,t}] != 0)
-					return feasibility_state::NOT_FEASIBLE_USERS;
-			}
+	// Verify for each user type (i, m, t) that the number of users moved does not exceed the number
+	// of available ones (the two arrays have the same layout, hence they are compared element by element)
+	if(same_cell)
+		return feasibility_state::NOT_FEASIBLE_USERS;
+	multi_array<int, 3>::const_iterator available = problem.users_available.begin();
+	for(multi_array<int, 3>::const_iterator moved = users_moved.begin(); moved != users_moved.end(); ++moved, ++available)
+		if(*moved > *available)
+			return feasibility_state::NOT_FEASIBLE_USERS;
 
 	// Compare the two computed objective function in order to verify the correctness
-	if(fabs(objfun_verify - objfun_value) > eps)
+	if(objfun_verify != objfun_value)
 		return feasibility_state::WRONG_OBJFUNCTVAL;
 
 	// If no problem has been detected, the solution is feasible
@@ -16,9 +16,12 @@
 
 #include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <functional>
 #include <limits>
+#include <map>
 #include <thread>
+#include <utility>
 
 #include "coiote_solver.h"
 #include "timer.h"
@@ -29,7 +32,6 @@ bool coiote_solver::solve(const unsigned long time_limit_ms) {
 
 	const double perc_normal = 0.50; // Constant used to specify how much available time to use in case of a 'standard' instance
 	const double perc_fewusers = 0.95; // Constant used to specify how much available time to use in case of a 'few users' instance
-	const unsigned nthreads = 8; // Constant used to specify how many threads will be used
 
 	const three_index_type three_dimensions = { n_cells, n_cust_types, n_time_steps };
 	const four_index_type four_dimensions = { n_cells, n_cells, n_cust_types, n_time_steps };
@@ -38,25 +40,71 @@ bool coiote_solver::solve(const unsigned long time_limit_ms) {
 	timer normal_timer((unsigned long)(time_limit_ms*perc_normal), [this](){ time_finished = true; });
 	timer fewusers_timer((unsigned long)(time_limit_ms*perc_fewusers), [this](){ fewusers_time_finished = true; });
 
+	// No solution has been found so far by any thread (the flags and the KPIs may be left by a previous call)
+	incumbent.store(no_solution);
+	time_finished = fewusers_time_finished = false;
+	fewusers_mode.store(false);
+	kpi.clear();
+
 	// Generate the necessary statistics for the following computations (i.e. cost-based sorting)
 	initialization_phase();
+	changed_cells.clear();
+	changed_sources.clear();
 
-	double obj_function = std::numeric_limits<double>::infinity(); // Best objective function value found so far
+	objective_type obj_function = no_solution; // Best objective function value found so far
 	std::mt19937 rndgen; // Master random generator (a seed is not used in order to make it deterministic)
 
-	std::array<th_parameter*, nthreads> parameters;
-	std::array<std::thread, nthreads> threads;
-	multi_array<int, 4>* best_solution = &solution;	// Pointer to the best solution found so far
-
-	// Create one 'th_parameter' structure for each thread and then fire it
-	for(size_type a = 0; a < nthreads; a++) {
-		parameters[a] = new th_parameter(rndgen(), three_dimensions, four_dimensions);
+	// The Lagrangian relaxation, if needed, takes the place of one of the threads searching for a solution
+	const bool lagrangian_bound = config.lagrangian_bound || config.gap_tolerance > 0;
+	const unsigned n_threads = (lagrangian_bound && config.n_threads > 1) ? config.n_threads - 1 : config.n_threads;
+	running_threads.store(n_threads);
+	std::vector<th_parameter*> parameters(n_threads);
+	std::vector<std::thread> threads(n_threads);
+	sparse_solution* best_solution = &solution;	// Pointer to the best solution found so far
+
+	// If requested and there are multiple NUMA nodes, replicate the instance data on each node used by the
+	// threads: each replica is built by a thread running on that node, so that its memory is local to it
+	cpu_topology topology;
+	const bool replicate = config.numa_replicas && topology.n_nodes() > 1;
+	std::map<unsigned, numa_replica*> replicas;
+	if(replicate) {
+		for(size_type a = 0; a < n_threads; a++)
+			replicas[topology.node(a)] = nullptr;
+
+		std::vector<std::thread> builders;
+		for(std::map<unsigned, numa_replica*>::iterator it = replicas.begin(); it != replicas.end(); ++it) {
+			builders.push_back(std::thread([this, &topology, it]() {
+				topology.pin_current_to_node(it->first);
+				it->second = new numa_replica(problem, statistics, n_cells);
+			}));
+		}
+		for(size_type a = 0; a < builders.size(); a++)
+			builders[a].join();
+	}
+	const search_data shared_data = { &problem.costs, &problem.users_available, statistics.costs_order };
+
+	// Create one 'th_parameter' structure for each thread and then fire it (the thread pins itself to a CPU if
+	// requested or if the data is replicated, in order for the thread to run on the same node of its replica)
+	const cpu_topology* pinning = (config.pin_threads || replicate) ? &topology : nullptr;
+	for(size_type a = 0; a < n_threads; a++) {
+		const search_data data = replicate ? replicas[topology.node(a)]->data() : shared_data;
+		parameters[a] = new th_parameter(rndgen(), three_dimensions, four_dimensions, data, pinning, a);
 		threads[a] = std::thread( &coiote_solver::thread_body, this, parameters[a] );
 	}
 
+	// Raise the lower bound while the threads are searching, in order to certify the quality of the solution
+	std::thread bound_thread;
+	if(lagrangian_bound)
+		bound_thread = std::thread(&coiote_solver::bound_body, this);
+
+	// If requested, monitor the search in order to stop it as soon as it converges
+	if(config.stop_gain > 0 || config.gap_tolerance > 0) {
+		monitor_convergence(start_time, time_limit_ms*perc_normal/1000, time_limit_ms*perc_fewusers/1000);
+	}
+
 	// Join again with all the threads and get the best solution found
 	size_type iter_counter = 0;
-	for(size_type a = 0; a < nthreads; a++) {
+	for(size_type a = 0; a < n_threads; a++) {
 		threads[a].join();
 
 		iter_counter += parameters[a]->iterations;
@@ -65,47 +113,223 @@ bool coiote_solver::solve(const unsigned long time_limit_ms) {
 			best_solution = &(parameters[a]->solution);
 		}
 	}
+	if(bound_thread.joinable())
+		bound_thread.join();
 
-	// Store the best solution found
-	solution = *best_solution;
+	// Store the best solution found (it is moved, since the thread parameters are going to be deleted)
+	if(best_solution != &solution)
+		solution = std::move(*best_solution);
 
-	for(size_type a = 0; a < nthreads; a++) {
+	for(size_type a = 0; a < n_threads; a++) {
 		delete(parameters[a]);
 	}
+	for(std::map<unsigned, numa_replica*>::iterator it = replicas.begin(); it != replicas.end(); ++it) {
+		delete(it->second);
+	}
 
 	// Stop the timers
 	normal_timer.stop();
 	fewusers_timer.stop();
 
 	// Handle the case of no feasible solution found
-	if(obj_function == std::numeric_limits<double>::infinity()) {
+	if(obj_function == no_solution) {
 		return (has_solution = false);
 	}
 
 	// Stop counting the elapsed time
 	auto end_time = std::chrono::steady_clock::now();
 
-	// Compute and store the KPIs (objective function, elapsed time, number of users for each type moved to another cell)
+	store_kpi(obj_function, std::chrono::duration<double>(end_time-start_time).count());
+	return (has_solution = true);
+}
+
+bool coiote_solver::set_activities(const size_type& j, const int activities) {
+	if(j >= n_cells || activities < 0)
+		return false;
+
+	if((problem.activities[j] > 0) != (activities > 0))
+		changed_cells.push_back(j);
+	problem.activities[j] = activities;
+	return true;
+}
+
+bool coiote_solver::set_users_available(const size_type& i, const size_type& m, const size_type& t, const int users) {
+	if(i >= n_cells || m >= n_cust_types || t >= n_time_steps || users < 0)
+		return false;
+
+	if((problem.users_available[{i,m,t}] > 0) != (users > 0))
+		changed_sources.push_back(statistics.sources.encode(i,m,t));
+	problem.users_available[{i,m,t}] = users;
+	return true;
+}
+
+bool coiote_solver::resolve(const unsigned long time_limit_ms) {
+	if(!has_solution)
+		return solve(time_limit_ms);
+
+	// Start counting the elapsed time at the very beginning of the function
+	auto start_time = std::chrono::steady_clock::now();
+
+	// Start the timer to manage the available time
+	timer normal_timer(time_limit_ms, [this](){ time_finished = true; });
+	time_finished = fewusers_time_finished = false;
+	kpi.clear();
+
+	// Update only the statistics affected by the changes and repair the current solution
+	refresh_statistics();
+	const search_data data = { &problem.costs, &problem.users_available, statistics.costs_order };
+	objective_type obj_function = repair(data, solution);
+
+	// If the solution cannot be repaired, solve the problem from scratch in the remaining time
+	if(obj_function == no_solution) {
+		normal_timer.stop();
+		const unsigned long elapsed_ms = (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now() - start_time).count();
+		return solve(std::max(time_limit_ms, elapsed_ms+1) - elapsed_ms);
+	}
+
+	// Improve the repaired solution until it is possible
+	objective_type gain = -1;
+	while(gain != 0 && !time_finished) {
+		gain = improving_phase(data, solution);
+		obj_function -= gain;
+	}
+	normal_timer.stop();
+
+	// Stop counting the elapsed time
+	auto end_time = std::chrono::steady_clock::now();
+
+	store_kpi(obj_function, std::chrono::duration<double>(end_time-start_time).count());
+	return (has_solution = true);
+}
+
+void coiote_solver::store_kpi(const objective_type obj_function, const double elapsed) {
+	// Compute and store the KPIs (objective function, elapsed time, number of users for each type moved to another cell,
+	// relative gap from the lower bound)
+	kpi.clear();
 	kpi.push_back(obj_function);
-	kpi.push_back(std::chrono::duration<double>(end_time-start_time).count());
+	kpi.push_back(elapsed);
+	std::vector<unsigned> n_users(n_cust_types, 0);
+	for(sparse_solution::const_iterator it = solution.begin(); it != solution.end(); ++it)
+		n_users[it->index[four_index::m]] += it->users;
 	for(size_type m = 0; m < n_cust_types; m++) {
-		unsigned n_users = 0;
-		for(size_type i = 0; i < n_cells; i++)
-			for(size_type j = 0; j < n_cells; j++)
-				for(size_type t = 0; t < n_time_steps; t++)
-					n_users += solution[{i,j,m,t}];
-		kpi.push_back(n_users);
+		kpi.push_back(n_users[m]);
 	}
-	return (has_solution = true);
+	kpi.push_back((obj_function > 0) ? (double)(obj_function - statistics.lower_bound) / obj_function : 0.0);
+}
+
+void coiote_solver::refresh_statistics() {
+	std::sort(changed_cells.begin(), changed_cells.end());
+	changed_cells.erase(std::unique(changed_cells.begin(), changed_cells.end()), changed_cells.end());
+	std::sort(changed_sources.begin(), changed_sources.end());
+
+	// Compute again all the lists of the cells whose demand has changed sign
+	for(std::vector<size_type>::const_iterator j = changed_cells.begin(); j != changed_cells.end(); ++j)
+		for(size_type m = 0; m < n_cust_types; m++)
+			fill_cells_order(m, *j);
+
+	// Insert the groups which have become available into (or remove the ones which have become unavailable
+	// from) the lists of all the other cells, preserving the order already computed
+	for(size_type a = 0; a < changed_sources.size(); ) {
+		const packed_source::value_type src = changed_sources[a];
+		size_type changes = 0;
+		for(; a < changed_sources.size() && changed_sources[a] == src; a++)
+			++changes;
+		if(changes % 2 == 0)
+			continue;
+
+		const size_type i = statistics.sources.i(src), m = statistics.sources.m(src), t = statistics.sources.t(src);
+		const bool available = (problem.users_available[{i,m,t}] > 0);
+		for(size_type j = 0; j < n_cells; j++) {
+			if(j == i || problem.activities[j] == 0 || std::binary_search(changed_cells.begin(), changed_cells.end(), j))
+				continue;
+			cost_list& list = statistics.costs_order[j].list(m);
+			if(available)
+				list.insert(src, problem.costs[{i,j,m,t}]);
+			else
+				list.remove(src, problem.costs[{i,j,m,t}]);
+		}
+	}
+	changed_cells.clear();
+	changed_sources.clear();
+
+	// Get again the maximum number of activities that must de done in one cell
+	statistics.max_activities = 0;
+	for(size_type j = 0; j < n_cells; j++)
+		statistics.max_activities = std::max(statistics.max_activities, problem.activities[j]);
+
+	// The slots depend on the maximum number of activities, hence they will be computed again if needed
+	delete(statistics.act_slots);
+	statistics.act_slots = nullptr;
+	statistics.lower_bound = compute_lower_bound();
+}
+
+coiote_solver::objective_type coiote_solver::repair(const search_data& data, sparse_solution& solution) {
+	const costs_matrix_type& costs = *data.costs;
+	const three_index_type three_dimensions = { n_cells, n_cust_types, n_time_steps };
+
+	tracked_array<int, 3> users_available(*data.users_available); // Users still available after the moves of the solution
+	std::vector<int> demand(problem.activities, problem.activities + n_cells); // Demand still to be satisfied in each cell
+
+	// Sort the moves according to decreasing costs
+	vector_moves_type moves;
+	moves.reserve(solution.size());
+	for(sparse_solution::const_iterator it = solution.begin(); it != solution.end(); ++it)
+		moves.push_back(it->index);
+	std::sort(moves.begin(), moves.end(), cmp_costs_desc(costs));
+
+	// Assign the available users to the moves starting from the least expensive ones, removing the users in excess
+	for(vector_moves_type::const_reverse_iterator it = moves.rbegin(); it != moves.rend(); ++it) {
+		const four_index_type& idx = *it;
+		int& available = users_available.modify({idx[four_index::i], idx[four_index::m], idx[four_index::t]});
+		const int users = solution[idx];
+		const int kept = std::min(users, available);
+		if(kept < users)
+			solution.add(idx, kept - users);
+		available -= kept;
+		demand[idx[four_index::j]] -= problem.act_per_user[idx[four_index::m]]*kept;
+	}
+
+	// Remove the most expensive users from the cells where more activities than necessary are done
+	for(vector_moves_type::const_iterator it = moves.begin(); it != moves.end(); ++it) {
+		const four_index_type& idx = *it;
+		const size_type j = idx[four_index::j], m = idx[four_index::m];
+		const int removed = std::min(solution[idx], -demand[j]/problem.act_per_user[m]);
+		if(removed > 0) {
+			solution.add(idx, -removed);
+			users_available.modify({idx[four_index::i], m, idx[four_index::t]}) += removed;
+			demand[j] += problem.act_per_user[m]*removed;
+		}
+	}
+
+	// Satisfy the remaining demand of each cell
+	cells_usage usage(three_dimensions, *data.users_available);
+	vector_moves_type inserted_indexes;
+	std::vector<size_type> first_available(n_cust_types), positions(n_cust_types);
+	for(size_type j = 0; j < n_cells; j++) {
+		if(demand[j] > 0 && satisfy_demand(data, j, demand[j], solution, users_available, usage,
+				inserted_indexes, first_available, positions) == no_solution)
+			return no_solution;
+	}
+
+	// Compute the objective function value of the repaired solution
+	objective_type obj_function = 0;
+	for(sparse_solution::const_iterator it = solution.begin(); it != solution.end(); ++it)
+		obj_function += (objective_type)costs[it->index]*it->users;
+	return obj_function;
 }
 
 void coiote_solver::thread_body(th_parameter* const param) {
 	const size_type iteration_limit = 10; // Constant used to specify how many iterations are done before trying to improve the solution
 
-	multi_array<int, 3> users_available(param->three_dimensions); // Number of available users in each cell (used by the greedy function)
-	multi_array<int, 4> current_solution(param->four_dimensions); // Current solution found through the greedy function
-	multi_array<int, 4> best_solution(param->four_dimensions); // Local best solution found through the greedy function
-	cells_usage usage(param->three_dimensions, problem.users_available); // Support structure to memorize the most 'chosen' users
+	// Pin the thread before allocating anything, so that its data is placed on the NUMA node it runs on
+	if(param->topology != nullptr)
+		param->topology->pin_current(param->index);
+
+	tracked_array<int, 3> users_available(*param->data.users_available); // Number of available users in each cell (used by the greedy function)
+	sparse_solution current_solution(param->four_dimensions); // Current solution found through the greedy function
+	sparse_solution best_solution(param->four_dimensions); // Local best solution found through the greedy function
+	cells_usage usage(param->three_dimensions, *param->data.users_available); // Support structure to memorize the most 'chosen' users
 
 	// Create a vector containing all the cells j to be visited
 	std::vector<size_type> order;
@@ -115,15 +339,15 @@ void coiote_solver::thread_body(th_parameter* const param) {
 			order.push_back(j);
 
 	// Define a function pointer in order to be able to change the greedy function if an instance with 'few users' is detected
-	typedef double(coiote_solver::*greedy_function_type)(multi_array<int, 4>&,
-		multi_array<int, 3>&, const std::vector<size_type>&, cells_usage&);
+	typedef objective_type(coiote_solver::*greedy_function_type)(const search_data&, sparse_solution&,
+		tracked_array<int, 3>&, const std::vector<size_type>&, cells_usage&, const objective_type);
 	greedy_function_type greedy_fn = &coiote_solver::greedy;
 	bool few_users_mode = false;
 
 	// Loop until there is enough time
 	volatile bool* current_time_finished = &(this->time_finished);
 	while(!(*current_time_finished)) {
-		double best_objfun = std::numeric_limits<double>::infinity();
+		objective_type best_objfun = no_solution;
 		size_type iterations = 0;
 
 		// Loop iteration_limit times (if enough time is available)
@@ -132,17 +356,21 @@ void coiote_solver::thread_body(th_parameter* const param) {
 			// Generate a new randomic visiting order for the cells
 			std::shuffle(order.begin(), order.end(), param->rndgen);
 
-			// Execute the greedy function and update the local best solution if necessary
-			double current_objfun;
-			if((current_objfun = (this->*greedy_fn)(current_solution, users_available, order, usage)) < best_objfun) {
+			// Execute the greedy function and update the local best solution if necessary. A construction is aborted
+			// as soon as it exceeds the best one of the round (i.e. before the improvement), hence the first
+			// one is never aborted and a 'few users' instance can still be detected
+			objective_type current_objfun;
+			if((current_objfun = (this->*greedy_fn)(param->data, current_solution, users_available, order, usage, best_objfun)) < best_objfun &&
+				current_objfun != aborted_solution) {
 				best_objfun = current_objfun;
 				best_solution = current_solution;
+				publish_incumbent(best_objfun);
 			}
 
 			iterations++;
 
 			// Handle the case of a 'few users' instance (the greedy has not been able to find a solution)
-			if(current_objfun == std::numeric_limits<double>::infinity() && !few_users_mode) {
+			if(current_objfun == no_solution && !few_users_mode) {
 				// Create the necessary support structure
 				if(statistics.act_slots == nullptr) {
 					statistics.act_slots = new activities_slots(statistics.max_activities, n_cust_types, problem.act_per_user);
@@ -150,6 +378,7 @@ void coiote_solver::thread_body(th_parameter* const param) {
 
 				// Enter 'few users' mode changing the greedy function used and increasing the available time
 				few_users_mode = true;
+				fewusers_mode.store(true);
 				current_time_finished = &(this->fewusers_time_finished);
 				greedy_fn = &coiote_solver::greedy_few_users;
 			}
@@ -157,10 +386,10 @@ void coiote_solver::thread_body(th_parameter* const param) {
 		param->iterations += iterations;
 
 		// If the local best solution found by the greedy function is feasible, try to improve it
-		if(best_objfun != std::numeric_limits<double>::infinity()) {
-			double gain = -1;
+		if(best_objfun != no_solution) {
+			objective_type gain = -1;
 			while(gain != 0 && !time_finished) {
-				gain = improving_phase(best_solution);
+				gain = improving_phase(param->data, best_solution);
 				best_objfun -= gain;
 			}
 		}
@@ -169,108 +398,291 @@ void coiote_solver::thread_body(th_parameter* const param) {
 		if(best_objfun < param->obj_function) {
 			param->obj_function = best_objfun;
 			param->solution = best_solution;
+			publish_incumbent(best_objfun);
+		}
+	}
+
+	running_threads.fetch_sub(1);
+}
+
+void coiote_solver::monitor_convergence(const std::chrono::steady_clock::time_point& start_time,
+		const double normal_limit, const double fewusers_limit) {
+	const std::chrono::milliseconds period(10); // Interval between two samples of the incumbent
+	const double min_window = 0.2; // Minimum length (in seconds) of the window used to estimate the rate of improvement
+
+	// Samples of the incumbent (elapsed time and objective function value), taken only once a solution exists
+	std::vector<std::pair<double, objective_type>> samples;
+
+	while(running_threads.load() > 0) {
+		std::this_thread::sleep_for(period);
+		const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+		const objective_type current = incumbent.load(std::memory_order_relaxed);
+		if(current == no_solution)
+			continue;
+		samples.push_back(std::make_pair(elapsed, current));
+
+		// Stop as soon as the solution is close enough to the lower bound (or it is proven to be optimal)
+		bool stop = (current - statistics.lower_bound <= config.gap_tolerance*current);
+
+		// Estimate the gain in the remaining time according to the improvement obtained in the last window
+		const double window = std::max(min_window, elapsed/2);
+		if(!stop && config.stop_gain > 0 && elapsed - samples.front().first >= window) {
+			std::vector<std::pair<double, objective_type>>::const_iterator past = std::lower_bound(samples.begin(), samples.end(),
+				std::make_pair(elapsed - window, std::numeric_limits<objective_type>::min()));
+			const double rate = (double)(past->second - current) / (elapsed - past->first);
+			const double remaining = (fewusers_mode.load() ? fewusers_limit : normal_limit) - elapsed;
+			stop = (rate*remaining < config.stop_gain*current);
+		}
+
+		if(stop) {
+			time_finished = true;
+			fewusers_time_finished = true;
+			break;
+		}
+	}
+}
+
+coiote_solver::objective_type coiote_solver::compute_lower_bound() const {
+	double lower_bound = 0;
+	for(size_type j = 0; j < n_cells; j++)
+		if(problem.activities[j] > 0)
+			lower_bound += cheapest_ratio(j) * problem.activities[j];
+	// The costs are integers, hence also the bound can be rounded up (apart from rounding errors)
+	return (objective_type)std::ceil(lower_bound - 1e-6);
+}
+
+double coiote_solver::cheapest_ratio(const size_type& j) const {
+	double min_ratio = std::numeric_limits<double>::infinity();
+	const cells_order& co = statistics.costs_order[j];
+	for(size_type m = 0; m < co.size(); m++) {
+		const cost_list& list = co.list(m);
+		if(list.size() == 0)
+			continue;
+		// The first element is the cheapest one only once the order has been computed up to it
+		list.ensure_sorted(0);
+		min_ratio = std::min(min_ratio, list.cost(0) / list.act_per_user());
+	}
+	return (min_ratio != std::numeric_limits<double>::infinity()) ? min_ratio : 0.0;
+}
+
+void coiote_solver::bound_body() {
+	const size_type max_iterations = 200; // Maximum number of subgradient iterations
+	const size_type max_stalls = 10; // Iterations without improvement after which the step is halved
+	const double min_step_scale = 1e-3; // Scale of the step below which the multipliers are not worth updating
+
+	const size_type n_sources = n_cells*n_cust_types*n_time_steps;
+	std::vector<double> multipliers(n_cells, 0.0);
+	std::vector<double> subgradient(n_cells);
+	std::vector<double> reduced(n_sources); // Most negative reduced cost of each group of users (i, m, t)
+	std::vector<size_type> chosen(n_sources); // Destination cell corresponding to the reduced cost
+
+	// Start from the cheapest ratio of each cell, for which the relaxation gives exactly compute_lower_bound()
+	for(size_type j = 0; j < n_cells; j++)
+		if(problem.activities[j] > 0)
+			multipliers[j] = cheapest_ratio(j);
+
+	double step_scale = 2;
+	double best_value = 0;
+	size_type stalls = 0;
+	const multi_array<int, 3>::const_iterator users_available = problem.users_available.begin();
+	for(size_type iter = 0; iter < max_iterations && step_scale > min_step_scale && running_threads.load() > 0; iter++) {
+		// Solve the relaxation: the costs of a pair (j, m) are stored contiguously for all (i, t)
+		std::fill(reduced.begin(), reduced.end(), 0.0);
+		for(size_type j = 0; j < n_cells; j++) {
+			if(multipliers[j] <= 0)
+				continue;
+			for(size_type m = 0; m < n_cust_types; m++) {
+				const double price = multipliers[j] * problem.act_per_user[m];
+				costs_matrix_type::const_iterator costs = problem.costs.get_iterator({0,j,m,0});
+				for(size_type i = 0; i < n_cells; i++) {
+					if(i == j) continue; // Users cannot do activities in their source cell
+					const packed_source::value_type first = statistics.sources.encode(i,m,0);
+					for(size_type t = 0; t < n_time_steps; t++) {
+						const double value = costs[i*n_time_steps + t] - price;
+						if(value < reduced[first + t]) {
+							reduced[first + t] = value;
+							chosen[first + t] = j;
+						}
+					}
+				}
+			}
+		}
+
+		// Compute the value of the relaxation and the subgradient (the demand not satisfied in each cell)
+		double value = 0;
+		for(size_type j = 0; j < n_cells; j++) {
+			value += multipliers[j] * problem.activities[j];
+			subgradient[j] = problem.activities[j];
 		}
+		for(size_type src = 0; src < n_sources; src++) {
+			if(reduced[src] < 0 && users_available[src] > 0) {
+				value += reduced[src] * users_available[src];
+				subgradient[chosen[src]] -= (double)problem.act_per_user[statistics.sources.m(src)] * users_available[src];
+			}
+		}
+
+		// Publish the bound if it is better (the costs are integers, hence it can be rounded up apart from rounding errors)
+		if(value > best_value) {
+			best_value = value;
+			stalls = 0;
+			const objective_type bound = (objective_type)std::ceil(value - 1e-9*value - 1e-6);
+			if(bound > statistics.lower_bound)
+				statistics.lower_bound = bound;
+		}
+		else if(++stalls >= max_stalls) {
+			step_scale /= 2;
+			stalls = 0;
+		}
+
+		// Update the multipliers through a Polyak step towards the incumbent (or an estimate, if none is available yet)
+		const objective_type current = incumbent.load(std::memory_order_relaxed);
+		const double upper_bound = (current != no_solution) ? (double)current : 1.1*best_value + 1;
+		if(upper_bound <= statistics.lower_bound)
+			break; // The solution is proven to be optimal
+		double norm = 0;
+		for(size_type j = 0; j < n_cells; j++)
+			norm += subgradient[j] * subgradient[j];
+		if(norm == 0)
+			break; // The relaxed solution is feasible, hence the bound cannot be improved
+		const double step = step_scale * (upper_bound - value) / norm;
+		for(size_type j = 0; j < n_cells; j++)
+			multipliers[j] = std::max(0.0, multipliers[j] + step*subgradient[j]);
 	}
 }
 
-double coiote_solver::greedy(multi_array<int, 4>& solution, multi_array<int, 3>& users_available,
-		const std::vector<size_type>& order, cells_usage& usage) {
+void coiote_solver::publish_incumbent(const objective_type obj_function) {
+	objective_type current = incumbent.load(std::memory_order_relaxed);
+	// Retry until either the value is stored or another thread has published a better one
+	while(obj_function < current && !incumbent.compare_exchange_weak(current, obj_function, std::memory_order_relaxed)) {}
+}
 
-	double obj_function = 0;
+coiote_solver::objective_type coiote_solver::greedy(const search_data& data, sparse_solution& solution, tracked_array<int, 3>& users_available,
+		const std::vector<size_type>& order, cells_usage& usage, const objective_type abort_above) {
+	objective_type obj_function = 0;
 
-	solution.reset(); // Reset the solution to be built
-	users_available = problem.users_available; // All the users are initially available
+	solution.clear(); // Reset the solution to be built
+	users_available.restore(); // All the users are initially available (only the ones modified by the previous run are restored)
 
 	vector_moves_type inserted_indexes; // Support vector to memorize all users moved to the current cell j
-	four_index_type idx;
+	std::vector<size_type> first_available(n_cust_types); // Position of the first available user in each list of the current cell
+	std::vector<size_type> positions(n_cust_types); // Positions used to iterate through the lists
 
 	// For each cell j to be visited (according to the current order)
 	for(std::vector<size_type>::const_iterator it = order.begin(); it != order.end(); ++it) {
-		const size_type j = *it;
-
-		int demand = problem.activities[j];
-		inserted_indexes.clear();
-
-		// Until there is demand to be satisfied in the current cell
-		while(demand > 0) {
-			size_type min_i = 0, min_m = 0, min_t = 0;
-			double cost, min_cost = std::numeric_limits<double>::infinity();
+		const objective_type cell_cost = satisfy_demand(data, *it, problem.activities[*it], solution, users_available,
+			usage, inserted_indexes, first_available, positions);
+		if(cell_cost == no_solution) {
+			return no_solution;
+		}
+		obj_function += cell_cost;
 
-			// Get the cost-based index order to be used according to the remaining demand
-			unsigned co_idx = statistics.get_costs_idx(demand);
-			cells_order::const_iterator co_it = statistics.costs_order[co_idx][j].begin();
-			cells_order::const_iterator co_end = statistics.costs_order[co_idx][j].end();
+		// Abort the construction if it is already worse than the threshold
+		// (the objective function cannot decrease while satisfying the remaining cells)
+		if(obj_function > abort_above) {
+			return aborted_solution;
+		}
+	}
 
-			// Loop according to not-decreasing costs until all users available have been considered
-			while((co_it = statistics.costs_order[co_idx][j].get_least_expensive(co_it, users_available)) != co_end) {
-				idx = *(co_it++);
+	return obj_function;
+}
 
-				// Get the indexes and the cost (reduced by the number of activities) for each considered user
-				size_type i = idx[four_index::i], m = idx[four_index::m], t = idx[four_index::t];
-				cost = problem.costs[idx] / std::min(demand, problem.act_per_user[m]);
+coiote_solver::objective_type coiote_solver::satisfy_demand(const search_data& data, const size_type j, int demand,
+		sparse_solution& solution, tracked_array<int, 3>& users_available, cells_usage& usage, vector_moves_type& inserted_indexes,
+		std::vector<size_type>& first_available, std::vector<size_type>& positions) {
+	const costs_matrix_type& costs = *data.costs; // Costs of the moves (possibly local to the NUMA node)
 
-				// If the current cost is greater than the previous one stop iterating because no better choice is available
-				if(cost > min_cost) {
-					break;
-				}
+	objective_type obj_function = 0;
+	four_index_type idx;
 
-				// Replace the selected user with the current one if it is better (first iteration)
-				// or if it could be convenient because in the previous greedy executions it was less used
-				if(cost < min_cost || usage.should_replace({i,m,t}, {min_i,min_m,min_t})) {
-						min_cost = cost;
-						min_i = i;
-						min_m = m;
-						min_t = t;
-				}
+	// Position of the first available user in each cost-based list of the cell: users are only made
+	// unavailable while satisfying the demand, hence the elements preceding it are known to be exhausted
+	// and need not be scanned again
+	inserted_indexes.clear();
+	std::fill(first_available.begin(), first_available.end(), 0);
+
+	// Until there is demand to be satisfied in the current cell
+	while(demand > 0) {
+		packed_source::value_type min_src = 0;
+		double cost, min_cost = std::numeric_limits<double>::infinity();
+
+		// Get the cost-based order of the current cell and the limit to be used according to the remaining demand
+		const cells_order& co = data.costs_order[j];
+		const size_type co_end = co.size();
+		const int max_done = statistics.get_max_done(demand);
+
+		// Skip the users already exhausted, remembering the positions for the next iterations
+		co.skip_unavailable(first_available.data(), users_available.array());
+		std::copy(first_available.begin(), first_available.end(), positions.begin());
+
+		// Loop according to not-decreasing costs until all users available have been considered
+		for(size_type l; (l = co.get_least_expensive(positions.data(), max_done, users_available.array())) != co_end; ++positions[l]) {
+			const cost_list& list = co.list(l);
+			const size_type pos = positions[l];
+
+			// Get the cost (reduced by the number of activities) for each considered user
+			cost = list.cost(pos) / std::min(demand, list.act_per_user());
+
+			// If the current cost is greater than the previous one stop iterating because no better choice is available
+			if(cost > min_cost) {
+				break;
 			}
 
-			// No available users have been found to satisfy the current demand: impossible to continue
-			if(min_cost == std::numeric_limits<double>::infinity()) {
-				return min_cost;
+			// Replace the selected user with the current one if it is better (first iteration)
+			// or if it could be convenient because in the previous greedy executions it was less used
+			if(cost < min_cost || usage.should_replace(list.source(pos), min_src)) {
+					min_cost = cost;
+					min_src = list.source(pos);
 			}
+		}
 
-			// Compute the number of users to be assigned according to the availability and the need
-			unsigned nusers = std::min(demand/problem.act_per_user[min_m], users_available[{min_i, min_m, min_t}]);
-			if(nusers == 0) {
-				nusers = 1;
-			}
+		// No available users have been found to satisfy the current demand: impossible to continue
+		if(min_cost == std::numeric_limits<double>::infinity()) {
+			return no_solution;
+		}
 
-			idx = {min_i, j, min_m, min_t};
-			solution[idx] += nusers; // Add the selected users to the solution
-			obj_function += problem.costs[idx]*nusers; // Update the objective function value
-			demand -= problem.act_per_user[min_m]*nusers; // Update the demand
-			users_available[{min_i,min_m,min_t}] -= nusers; // Make the selected users no more available
+		const size_type min_i = statistics.sources.i(min_src), min_m = statistics.sources.m(min_src), min_t = statistics.sources.t(min_src);
 
-			inserted_indexes.push_back(idx);
-			usage.add({min_i,min_m,min_t}, nusers);
+		// Compute the number of users to be assigned according to the availability and the need
+		unsigned nusers = std::min(demand/problem.act_per_user[min_m], users_available.array().begin()[min_src]);
+		if(nusers == 0) {
+			nusers = 1;
 		}
 
-		// In case more activities than necessary are done (it happens because users can do more than one task),
-		// try to check if some of them (usually at most one) may be removed (the typical case is when at the beginning
-		// users that can do few activities (e.g. one) are selected according to the cost-based order and at the end
-		// users able to perform more tasks (e.g. three) are chosen because more convenient)
-		if(demand < 0) {
-			demand = -demand;
-
-			// Sort the inserted users in the current cell j according to decreasing costs
-			std::sort(inserted_indexes.begin(), inserted_indexes.end(), cmp_costs_desc(problem.costs));
-
-			// Loop through them until there is an excess of activities done and remove the most
-			// expensive users (if possible) updating at the same time the current solution
-			vector_moves_type::const_iterator ins_idx_iter = inserted_indexes.begin();
-			while(demand > 0 && ins_idx_iter != inserted_indexes.end()) {
-				idx = *ins_idx_iter;
-				if(problem.act_per_user[idx[four_index::m]] <= demand) {
-					if((--solution[idx]) == 0) {
-						++ins_idx_iter;
-					}
-					obj_function -= problem.costs[idx];
-					demand -= problem.act_per_user[idx[2]];
-					users_available[{idx[four_index::i], idx[four_index::m], idx[four_index::t]}]++;
-				}
-				else {
+		idx = {min_i, j, min_m, min_t};
+		solution.add(idx, nusers); // Add the selected users to the solution
+		obj_function += (objective_type)costs[idx]*nusers; // Update the objective function value
+		demand -= problem.act_per_user[min_m]*nusers; // Update the demand
+		users_available.modify(min_src) -= nusers; // Make the selected users no more available
+
+		inserted_indexes.push_back(idx);
+		usage.add(min_src, nusers);
+	}
+
+	// In case more activities than necessary are done (it happens because users can do more than one task),
+	// try to check if some of them (usually at most one) may be removed (the typical case is when at the beginning
+	// users that can do few activities (e.g. one) are selected according to the cost-based order and at the end
+	// users able to perform more tasks (e.g. three) are chosen because more convenient)
+	if(demand < 0) {
+		demand = -demand;
+
+		// Sort the inserted users in the current cell j according to decreasing costs
+		std::sort(inserted_indexes.begin(), inserted_indexes.end(), cmp_costs_desc(costs));
+
+		// Loop through them until there is an excess of activities done and remove the most
+		// expensive users (if possible) updating at the same time the current solution
+		vector_moves_type::const_iterator ins_idx_iter = inserted_indexes.begin();
+		while(demand > 0 && ins_idx_iter != inserted_indexes.end()) {
+			idx = *ins_idx_iter;
+			if(problem.act_per_user[idx[four_index::m]] <= demand) {
+				if(solution.add(idx, -1) == 0) {
 					++ins_idx_iter;
 				}
+				obj_function -= costs[idx];
+				demand -= problem.act_per_user[idx[2]];
+				users_available.modify({idx[four_index::i], idx[four_index::m], idx[four_index::t]})++;
+			}
+			else {
+				++ins_idx_iter;
 			}
 		}
 	}
@@ -278,13 +690,15 @@ double coiote_solver::greedy(multi_array<int, 4>& solution, multi_array<int, 3>&
 	return obj_function;
 }
 
-double coiote_solver::greedy_few_users(multi_array<int, 4>& solution, multi_array<int, 3>& users_available,
-		const std::vector<size_type>& order, cells_usage& usage) {
+coiote_solver::objective_type coiote_solver::greedy_few_users(const search_data& data, sparse_solution& solution, tracked_array<int, 3>& users_available,
+		const std::vector<size_type>& order, cells_usage& usage, const objective_type abort_above) {
+	(void)usage; // The users are chosen only according to their costs (the parameter is required by the greedy function type)
+	const costs_matrix_type& costs = *data.costs; // Costs of the moves (possibly local to the NUMA node)
 
-	double obj_function = 0;
+	objective_type obj_function = 0;
 
-	solution.reset(); // Reset the solution to be built
-	users_available = problem.users_available; // All the users are initially available
+	solution.clear(); // Reset the solution to be built
+	users_available.restore(); // All the users are initially available (only the ones modified by the previous run are restored)
 	four_index_type idx;
 
 	// Generate a vector which for ach cell j to be visited associates the demand to be satisfied
@@ -293,6 +707,10 @@ double coiote_solver::greedy_few_users(multi_array<int, 4>& solution, multi_arra
 	for(size_type b = 0; b < order.size(); b++)
 		remaining_demand[b] = std::make_pair(order[b], problem.activities[order[b]]);
 
+	// Position of the first available user in each cost-based list of the current cell j (see greedy())
+	std::vector<size_type> first_available(n_cust_types);
+	std::vector<size_type> positions(n_cust_types); // Positions used to iterate through the lists
+
 	// Loop two times: the first trying to move users in a conservative way (without wasting any activity)
 	// and the second trying to satisfy all the remaining activities (enabling wasting)
 	bool enable_wasting = false;
@@ -308,23 +726,31 @@ double coiote_solver::greedy_few_users(multi_array<int, 4>& solution, multi_arra
 				continue;
 			}
 
+			std::fill(first_available.begin(), first_available.end(), 0);
+
 			// Until there is demand to be satisfied in the current cell
 			while(demand > 0) {
-				size_type min_i = 0, min_m = 0, min_t = 0;
+				packed_source::value_type min_src = 0;
+				int min_act = 0;
 				double cost, min_cost = std::numeric_limits<double>::infinity();
 
-				// Get the cost-based index order to be used according to the remaining demand
-				unsigned co_idx = statistics.get_costs_idx(demand);
-				cells_order::const_iterator co_it = statistics.costs_order[co_idx][j].begin();
-				cells_order::const_iterator co_end = statistics.costs_order[co_idx][j].end();
+				// Get the cost-based order of the current cell and the limit to be used according to the remaining demand
+				const cells_order& co = data.costs_order[j];
+				const size_type co_end = co.size();
+				const int max_done = statistics.get_max_done(demand);
+
+				// Skip the users already exhausted, remembering the positions for the next iterations
+				co.skip_unavailable(first_available.data(), users_available.array());
+				std::copy(first_available.begin(), first_available.end(), positions.begin());
 
 				// Loop according to not-decreasing costs until all users available have been considered
-				while((co_it = statistics.costs_order[co_idx][j].get_least_expensive(co_it, users_available)) != co_end) {
-					idx = *(co_it++);
+				for(size_type l; (l = co.get_least_expensive(positions.data(), max_done, users_available.array())) != co_end; ++positions[l]) {
+					const cost_list& list = co.list(l);
+					const size_type pos = positions[l];
 
-					// Get the indexes and the cost (reduced by the number of activities) for each considered user
-					size_type i = idx[four_index::i], m = idx[four_index::m], t = idx[four_index::t];
-					cost = problem.costs[idx] / std::min(demand, problem.act_per_user[m]);
+					// Get the cost (reduced by the number of activities) for each considered user
+					const int act = list.act_per_user();
+					cost = list.cost(pos) / std::min(demand, act);
 
 					// If the current cost is greater than the previous one stop iterating because no better choice is available
 					if(cost > min_cost) {
@@ -334,12 +760,11 @@ double coiote_solver::greedy_few_users(multi_array<int, 4>& solution, multi_arra
 					// Replace the selected user with the current one if more convenient or if it is able to perform more tasks
 					// During the first global iteration (enable_wasting = false) only choices not leading to a waste of
 					// activities can be done in order to maximize the probability to be able to find a feasible solution
-					if((enable_wasting || statistics.act_slots->can_be_selected(demand, m)) &&
-						(cost < min_cost || problem.act_per_user[m] > problem.act_per_user[min_m])) {
+					if((enable_wasting || statistics.act_slots->can_be_selected(demand, statistics.sources.m(list.source(pos)))) &&
+						(cost < min_cost || act > min_act)) {
 							min_cost = cost;
-							min_i = i;
-							min_m = m;
-							min_t = t;
+							min_src = list.source(pos);
+							min_act = act;
 					}
 				}
 
@@ -347,7 +772,7 @@ double coiote_solver::greedy_few_users(multi_array<int, 4>& solution, multi_arra
 				if(min_cost == std::numeric_limits<double>::infinity()) {
 					// If the iteration is already the final one (enable_wasting = true), then no feasible solution can be found
 					if(enable_wasting) {
-						return min_cost;
+						return no_solution;
 					}
 
 					// Otherwise continue with the next cell, hoping the second iteration
@@ -355,14 +780,23 @@ double coiote_solver::greedy_few_users(multi_array<int, 4>& solution, multi_arra
 					break;
 				}
 
+				const size_type min_i = statistics.sources.i(min_src);
+				const size_type min_m = statistics.sources.m(min_src);
+				const size_type min_t = statistics.sources.t(min_src);
+
 				idx = {min_i, j, min_m, min_t};
-				solution[idx]++; // Add the selected user to the solution
-				obj_function += problem.costs[idx]; // Update the objective function value
+				solution.add(idx, 1); // Add the selected user to the solution
+				obj_function += costs[idx]; // Update the objective function value
 				demand -= problem.act_per_user[min_m]; // Update the demand
-				users_available[{min_i,min_m,min_t}]--; // Make the selected user no more available
+				users_available.modify(min_src)--; // Make the selected user no more available
 			}
 
 			remaining_demand[b] = std::make_pair(j, demand); // Update the remaining demand
+
+			// Abort the construction if it is already worse than the threshold
+			if(obj_function > abort_above) {
+				return aborted_solution;
+			}
 		}
 		enable_wasting = true; // Enable wasting (second phase)
 	}
@@ -379,54 +813,69 @@ void coiote_solver::initialization_phase() {
 	std::sort(statistics.act_per_user_sorted, statistics.act_per_user_sorted+n_cust_types, std::greater<int>());
 	statistics.max_act_per_user = statistics.act_per_user_sorted[0];
 
-	// Create a number of threads equal to the number of user types, each one entitled to generate an array
-	// of ordered indexes based on the cost per activity (depending on how much tasks that user type can do)
+	// Create the worker threads, which share the generation of the arrays of ordered indexes
+	// based on the cost for all the destination cells and user types
+	std::atomic<size_type> next_task(0);
 	std::vector<std::thread> threads;
-	for(size_type m = 0; m < n_cust_types; m++)
-		threads.push_back(std::thread( &coiote_solver::fill_cells_order, this, m ));
+	for(size_type a = 0; a < config.n_threads; a++)
+		threads.push_back(std::thread( &coiote_solver::initialization_worker, this, &next_task ));
 
 	// Get the maximum number of activities that must de done in one cell
 	statistics.max_activities = 0;
 	for(size_type j = 0; j < n_cells; j++)
 		statistics.max_activities = std::max(statistics.max_activities, problem.activities[j]);
 
+	// The slots depend on the maximum number of activities (which may have been changed since the previous
+	// call, even without a solution to be refreshed), hence they will be computed again if needed
+	delete(statistics.act_slots);
+	statistics.act_slots = nullptr;
+
 	// Wait all threads have terminated before continuing
-	for(size_type m = 0; m < n_cust_types; m++)
-		threads[m].join();
+	for(size_type a = 0; a < threads.size(); a++)
+		threads[a].join();
+
+	statistics.lower_bound = compute_lower_bound();
 }
 
-void coiote_solver::fill_cells_order(const size_type& index) {
-	// For each cell j with a demand to be satisfied
-	for(size_type j = 0; j < n_cells; j++) {
+void coiote_solver::initialization_worker(std::atomic<size_type>* next_task) {
+	const size_type n_tasks = n_cust_types * n_cells;
 
-		// If the demand is zero it is not necessary to create the support structure for that cell
-		if(problem.activities[j] == 0)
-			continue;
+	// Pick the tasks (one for each user type and destination cell) until all have been assigned
+	size_type task;
+	while((task = next_task->fetch_add(1, std::memory_order_relaxed)) < n_tasks) {
+		fill_cells_order(task / n_cells, task % n_cells);
+	}
+}
 
-		statistics.costs_order[index][j].initialize((n_cells-1)*n_cust_types*n_time_steps);
-		// Loop through all the cells containing users (i, m, t), collecting the indexes
-		for(size_type i = 0; i < n_cells; i++) {
-			if(i == j) continue; // Users cannot do activities in their source cell
-			for(size_type m = 0; m < n_cust_types; m++) {
-				for(size_type t = 0; t < n_time_steps; t++) {
-					// The index is collected only if there is at least one user in that cell
-					if(problem.users_available[{i,m,t}] > 0) {
-						statistics.costs_order[index][j].push_back({i,j,m,t});
-					}
-				}
+void coiote_solver::fill_cells_order(const size_type& m, const size_type& j) {
+	// If the demand is zero it is not necessary to fill the support structure for that cell
+	// (it is only emptied, since it may still contain the data of a previous instance)
+	cost_list& list = statistics.costs_order[j].list(m);
+	if(problem.activities[j] == 0) {
+		list.initialize(0, problem.act_per_user[m]);
+		return;
+	}
+
+	list.initialize((n_cells-1)*n_time_steps, problem.act_per_user[m]);
+	// Loop through all the cells containing users (i, m, t), collecting the indexes
+	for(size_type i = 0; i < n_cells; i++) {
+		if(i == j) continue; // Users cannot do activities in their source cell
+		for(size_type t = 0; t < n_time_steps; t++) {
+			// The index is collected only if there is at least one user in that cell
+			if(problem.users_available[{i,m,t}] > 0) {
+				list.push_back(statistics.sources.encode(i,m,t), problem.costs[{i,j,m,t}]);
 			}
 		}
-
-		// Sort the indexes in a not-decreasing cost order, according to the comparator cmp_costs_asc
-		statistics.costs_order[index][j].sort(
-			(cmp_costs_asc(problem.costs, problem.act_per_user, statistics.act_per_user_sorted[index])));
 	}
+
+	// Sort the indexes in a not-decreasing cost order
+	list.sort();
 }
 
-double coiote_solver::improving_phase(multi_array<int, 4>& solution) {
-	moves_statistics statistics_moves = improving_setup(solution); // Generate the necessary support data structure
+coiote_solver::objective_type coiote_solver::improving_phase(const search_data& data, sparse_solution& solution) {
+	moves_statistics statistics_moves = improving_setup(data, solution); // Generate the necessary support data structure
 
-	double improvement = 0;
+	objective_type improvement = 0;
 	// For each move (i, m, t -> j) in the current solution
 	for(size_type a = 0; a < statistics_moves.moves.size() && !time_finished; a++) {
 		// For each number of users between the maximum number of activities an user type can do and zero
@@ -434,7 +883,7 @@ double coiote_solver::improving_phase(multi_array<int, 4>& solution) {
 			ti_parameter param(statistics_moves.moves[a], m); // Create the parameter structure
 
 			// Try to improve the current solution until it has success and there is enough time
-			while(!time_finished && try_improve(solution, param, statistics_moves)) {
+			while(!time_finished && try_improve(data, solution, param, statistics_moves)) {
 				// Update the current improvement in terms of objective function value
 				for(size_type b = 0; b < param.imp_moves.size(); b++) {
 					improvement	+= param.imp_moves[b].obj_gain;
@@ -447,37 +896,37 @@ double coiote_solver::improving_phase(multi_array<int, 4>& solution) {
 	return improvement;
 }
 
-coiote_solver::moves_statistics coiote_solver::improving_setup(multi_array<int, 4>& solution) {
+coiote_solver::moves_statistics coiote_solver::improving_setup(const search_data& data, sparse_solution& solution) {
 	moves_statistics statistics_moves(n_cells, n_cust_types, n_time_steps);
-	statistics_moves.users_available = problem.users_available; // Initialize the matrix of users available
-
-	// For each element of the solution matrix
-	for(size_type i = 0; i < n_cells; i++) {
-		for(size_type j = 0; j < n_cells; j++) {
-			if(i == j) continue; // If the source and destination cell are equal skip
-			for(size_type m = 0; m < n_cust_types; m++) {
-				for(size_type t = 0; t < n_time_steps; t++) {
-					int x = solution[{i,j,m,t}]; // Get the number of users moved from i, m, t to j
-					if(x == 0) continue; // If no users have been moved, go to the next element
-
-					// Otherwise update the support structure, reducing the number of available users,
-					// storing the current move in different vectors according to different criteria
-					// (i.e. source or destination cell) and updating the number of activities done in
-					// the current destination cell
-					statistics_moves.users_available[{i,m,t}] -= x;
-					statistics_moves.moves_from_i[i].push_back({i,j,m,t});
-					statistics_moves.moves_to_j[j].push_back({i,j,m,t});
-					statistics_moves.moves.push_back({i,j,m,t});
-					statistics_moves.done_in_j[j]+=x*problem.act_per_user[m];
-				}
-			}
-		}
+	statistics_moves.users_available = *data.users_available; // Initialize the matrix of users available
+
+	// Sort the moves composing the solution according to their indexes (the order of a sparse_solution is not specified)
+	std::vector<sparse_solution::move> moves(solution.begin(), solution.end());
+	std::sort(moves.begin(), moves.end(),
+		[](const sparse_solution::move& lhs, const sparse_solution::move& rhs) { return lhs.index < rhs.index; });
+
+	// For each move of the solution
+	for(std::vector<sparse_solution::move>::const_iterator it = moves.begin(); it != moves.end(); ++it) {
+		const four_index_type& idx = it->index;
+		size_type i = idx[four_index::i], j = idx[four_index::j], m = idx[four_index::m], t = idx[four_index::t];
+		if(i == j) continue; // If the source and destination cell are equal skip
+		int x = it->users; // Get the number of users moved from i, m, t to j
+
+		// Update the support structure, reducing the number of available users,
+		// storing the current move in different vectors according to different criteria
+		// (i.e. source or destination cell) and updating the number of activities done in
+		// the current destination cell
+		statistics_moves.users_available[{i,m,t}] -= x;
+		statistics_moves.moves_from_i[i].push_back(idx);
+		statistics_moves.moves_to_j[j].push_back(idx);
+		statistics_moves.moves.push_back(idx);
+		statistics_moves.done_in_j[j]+=x*problem.act_per_user[m];
 	}
 
 	return statistics_moves;
 }
 
-bool coiote_solver::try_improve(multi_array<int, 4>& solution, ti_parameter& param, moves_statistics& statistics_moves) {
+bool coiote_solver::try_improve(const search_data& data, sparse_solution& solution, ti_parameter& param, moves_statistics& statistics_moves) {
 	static const int min_gain = -4; // Constant used to specify the minimum gain allowed before stopping
 	static const int max_level = 5; // Constant used to specify the maximum level of recursion
 	static const int max_count = 20; // Constant used to specify the maximum number of iterations
@@ -500,43 +949,47 @@ bool coiote_solver::try_improve(multi_array<int, 4>& solution, ti_parameter& par
 
 	// Remove the decided number of users from the considered cell of the solution, updating the
 	// objective function gain and the number of activities to be replaced
-	double curr_gain = param.users_to_remove * problem.costs[curr_idx];
+	objective_type curr_gain = (objective_type)param.users_to_remove * (*data.costs)[curr_idx];
 	int act_removed = problem.act_per_user[m] * param.users_to_remove;
 	improved_move current_ic(i,j,m,t, -param.users_to_remove, -act_removed, curr_gain);
 	param.obj_gain_so_far += add_remove_user(current_ic, solution, statistics_moves, false);
 	moves.push_back(current_ic); // Add the current 'improving move' to the list
 
-	// Get the cost-based index order to be used according to the number of activities to be replaced and the destination cell j
-	unsigned co_idx = statistics.get_costs_idx(act_removed);
-	cells_order::const_iterator co_it = statistics.costs_order[co_idx][j].begin();
-	cells_order::const_iterator co_end = statistics.costs_order[co_idx][j].end();
+	// Get the cost-based order of the destination cell j and the limit to be used according to the number of activities to be replaced
+	const cells_order& co = data.costs_order[j];
+	const size_type co_end = co.size();
+	const int max_done = statistics.get_max_done(act_removed);
+	std::vector<size_type> positions(n_cust_types); // Positions used to iterate through the lists
 
 	unsigned count = 0;
-	// Loop according to not-decreasing costs until all users available have been considered
-	while(co_it != co_end) {
-		four_index_type new_idx = *(co_it++);
-		size_type new_i = new_idx[four_index::i], new_m = new_idx[four_index::m], new_t = new_idx[four_index::t];
+	// Loop according to not-decreasing costs until all users have been considered
+	for(size_type l; (l = co.get_least_expensive(positions.data(), max_done, *data.users_available)) != co_end; ++positions[l]) {
+		const cost_list& list = co.list(l);
+		const size_type pos = positions[l];
+		const packed_source::value_type src = list.source(pos);
+		size_type new_i = statistics.sources.i(src), new_m = statistics.sources.m(src), new_t = statistics.sources.t(src);
+		const four_index_type new_idx = {new_i, j, new_m, new_t};
 
 		// Compute the number of selected users to be added in order to perform the activities to be replaced
-		int users_to_add = std::ceil((double)act_removed/problem.act_per_user[new_m]);
+		int users_to_add = std::ceil((double)act_removed/list.act_per_user());
 
 		// In case the considered index is already in the tabu list or if more users are needed than the number of them
 		// available in the original problem in the given cell (i, m, t), skip and go to the next iteration
 		if(std::find(param.considered_cells.begin(), param.considered_cells.end(), new_idx) != param.considered_cells.end() ||
-			problem.users_available[{new_i,new_m,new_t}] < users_to_add) {
+			data.users_available->begin()[src] < users_to_add) {
 			continue;
 		}
 		unsigned prev_imp_size = moves.size();
 
 		// Add the considered users to the solution, updating the objective function gain
-		double curr_cost = problem.costs[new_idx] * users_to_add;
+		objective_type curr_cost = (objective_type)list.integer_cost(pos) * users_to_add;
 		improved_move current_ic(new_i, j, new_m, new_t, users_to_add, users_to_add*problem.act_per_user[new_m], -curr_cost);
 		param.obj_gain_so_far += add_remove_user(current_ic, solution, statistics_moves, false);
 		moves.push_back(current_ic); // Add the current 'improving move' to the list
 
 		// Verify if it is possible to remove some previuosly inserted users because there is
 		// some excess of activities done due to the different abilities of the types of users
-		param.obj_gain_so_far += get_removable(j, solution, statistics_moves, moves);
+		param.obj_gain_so_far += get_removable(data, j, solution, statistics_moves, moves);
 
 		// Interrupt the search if the current gain is lower than the threshold, if the
 		// number of iterations is above the limit or if the availabile time is finished
@@ -545,7 +998,7 @@ bool coiote_solver::try_improve(multi_array<int, 4>& solution, ti_parameter& par
 
 		// Compute the number of users considered in this iteration still available:
 		// in case it is not negative, it means that the current solution is feasible
-		int users_available = statistics_moves.users_available[{new_i,new_m,new_t}];
+		int users_available = statistics_moves.users_available.begin()[src];
 		if(users_available >= 0) {
 
 			// In case the gain is positive, a better combination of users has been found and
@@ -576,7 +1029,7 @@ bool coiote_solver::try_improve(multi_array<int, 4>& solution, ti_parameter& par
 				// Build the parameter structure necessary for the next recursion step
 				ti_parameter next(param, statistics_moves.moves_from_i[new_i][a], -users_available);
 				// In case the next step has success, propagate the state by updating also the list of 'improving moves'
-				if(try_improve(solution, next, statistics_moves)) {
+				if(try_improve(data, solution, next, statistics_moves)) {
 					moves.insert(moves.end(), next.imp_moves.begin(), next.imp_moves.end());
 					param.imp_moves = moves;
 					return true;
@@ -601,29 +1054,29 @@ bool coiote_solver::try_improve(multi_array<int, 4>& solution, ti_parameter& par
 	return false;
 }
 
-double coiote_solver::add_remove_user(const improved_move& ic, multi_array<int, 4>& solution,
+coiote_solver::objective_type coiote_solver::add_remove_user(const improved_move& ic, sparse_solution& solution,
 	moves_statistics& statistics_moves, const bool undo) {
 
 	int flag = (undo) ? -1 : 1; // Flag depending whether the move must be done or undone
 
-	solution[ic.f_idx] += (ic.user_added * flag); // Add to or remove from the solution the number of considered users
+	solution.add(ic.f_idx, ic.user_added * flag); // Add to or remove from the solution the number of considered users
 	statistics_moves.users_available[ic.t_idx] -= (ic.user_added * flag); // Update the number of users available
 	statistics_moves.done_in_j[ic.f_idx[four_index::j]] += (ic.activities_added * flag); // Update the number of activities done
 	return (ic.obj_gain * flag);
 }
 
-double coiote_solver::get_removable(const size_type j, multi_array<int, 4>& solution,
+coiote_solver::objective_type coiote_solver::get_removable(const search_data& data, const size_type j, sparse_solution& solution,
 	moves_statistics& statistics_moves, std::vector<improved_move>& moves) {
 
 	// Compute how many activities are done more than the necessary ones
 	int redundancy = statistics_moves.done_in_j[j] - problem.activities[j];
-	double gain = 0;
+	objective_type gain = 0;
 
 	// If there is some redundancy try to remove it in order to increase the gain
 	if(redundancy > 0) {
 
 		// Sort the users doing activities in the cell j according to not-increasing costs
-		std::sort(statistics_moves.moves_to_j[j].begin(), statistics_moves.moves_to_j[j].end(), cmp_costs_desc(problem.costs));
+		std::sort(statistics_moves.moves_to_j[j].begin(), statistics_moves.moves_to_j[j].end(), cmp_costs_desc(*data.costs));
 		vector_moves_type::const_iterator ins_idx_iter = statistics_moves.moves_to_j[j].begin();
 
 		// Loop through them until there is an excess of activities done and remove the
@@ -633,7 +1086,7 @@ double coiote_solver::get_removable(const size_type j, multi_array<int, 4>& solu
 			if(problem.act_per_user[idx[four_index::m]] <= redundancy && solution[idx] > 0) {
 				redundancy -= problem.act_per_user[idx[four_index::m]];
 				improved_move current_ic(idx[four_index::i],idx[four_index::j],idx[four_index::m],idx[four_index::t],
-					-1, -problem.act_per_user[idx[four_index::m]], problem.costs[idx]);
+					-1, -problem.act_per_user[idx[four_index::m]], (*data.costs)[idx]);
 				moves.push_back(current_ic);
 				gain += add_remove_user(current_ic, solution, statistics_moves, false);
 			}
@@ -0,0 +1,287 @@
+// This file is part of CoIoTeSolver.
+
+// CoIoTeSolver is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CoIoTeSolver is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with CoIoTeSolver. If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef CPU_TOPOLOGY_H
+#define CPU_TOPOLOGY_H
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/**
+ * \brief This class provides information about the CPUs the process is allowed to use.
+ *
+ * The CPUs are detected through the affinity mask of the process (sched_getaffinity) and
+ * the number of them actually usable is further limited by the CPU quota of the control
+ * group the process belongs to (both cgroup v1 and v2 are supported). On systems different
+ * from Linux, the number of hardware threads reported by the standard library is used.
+ *
+ * The class also allows to pin threads to the allowed CPUs and provides the NUMA node
+ * each of them belongs to (read from /sys/devices/system/node on Linux; elsewhere all
+ * the CPUs are considered part of a single node).
+**/
+class cpu_topology {
+public:
+	/** \brief size_type is defined as an alias of size_t, an unsigned integral type. **/
+	typedef size_t size_type;
+
+	/**
+	 * \brief Constructor.
+	 *
+	 * Detects the CPUs the process is allowed to run on and the CPU quota.
+	**/
+	cpu_topology() {
+#if defined(__linux__)
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		if(sched_getaffinity(0, sizeof(set), &set) == 0) {
+			for(int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+				if(CPU_ISSET(cpu, &set))
+					cpus.push_back(cpu);
+		}
+#endif
+		if(cpus.empty()) {
+			for(unsigned cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); cpu++)
+				cpus.push_back(cpu);
+		}
+
+		quota = cgroup_quota();
+
+		// Associate each allowed CPU to its NUMA node (node zero if unknown)
+		cpu_nodes.assign(cpus.size(), 0);
+#if defined(__linux__)
+		std::vector<unsigned> online;
+		std::ifstream online_file("/sys/devices/system/node/online");
+		std::string list;
+		if(online_file >> list)
+			online = parse_list(list);
+		for(std::vector<unsigned>::const_iterator node = online.begin(); node != online.end(); ++node) {
+			std::ifstream cpulist_file("/sys/devices/system/node/node" + std::to_string(*node) + "/cpulist");
+			if(!(cpulist_file >> list))
+				continue;
+			const std::vector<unsigned> node_cpus = parse_list(list);
+			for(size_type a = 0; a < cpus.size(); a++)
+				if(std::find(node_cpus.begin(), node_cpus.end(), cpus[a]) != node_cpus.end())
+					cpu_nodes[a] = *node;
+		}
+#endif
+	}
+
+	/**
+	 * \brief Returns the number of threads which can run concurrently, i.e. the number of
+	 * allowed CPUs limited by the CPU quota (if any).
+	 * \return the number of threads (at least one).
+	**/
+	inline unsigned available_threads() const {
+		size_type n = cpus.size();
+		if(quota > 0)
+			n = std::min(n, quota);
+		return (unsigned)std::max<size_type>(n, 1);
+	}
+
+	/**
+	 * \brief Pins the calling thread to one of the allowed CPUs (chosen in round-robin according to the index).
+	 *
+	 * It should be called before the thread allocates its data, so that the memory is first touched
+	 * on the NUMA node the thread is going to run on.
+	 *
+	 * \param index index of the thread (e.g. the worker number).
+	 * \return true if the thread has been pinned correctly, false otherwise.
+	**/
+	bool pin_current(const size_type& index) const {
+#if defined(__linux__)
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(cpus[index % cpus.size()], &set);
+		return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+		(void)index;
+		return false;
+#endif
+	}
+
+	/**
+	 * \brief Returns the number of NUMA nodes the allowed CPUs belong to.
+	 * \return the number of nodes (at least one).
+	**/
+	inline size_type n_nodes() const {
+		std::vector<unsigned> distinct(cpu_nodes);
+		std::sort(distinct.begin(), distinct.end());
+		return std::unique(distinct.begin(), distinct.end()) - distinct.begin();
+	}
+
+	/**
+	 * \brief Returns the NUMA node of the CPU a thread is pinned to by pin_current().
+	 * \param index index of the thread (e.g. the worker number).
+	 * \return the identifier of the node.
+	**/
+	inline unsigned node(const size_type& index) const {
+		return cpu_nodes[index % cpus.size()];
+	}
+
+	/**
+	 * \brief Pins the calling thread to all the allowed CPUs belonging to the given NUMA node.
+	 * \param node the identifier of the node.
+	 * \return true if the thread has been pinned correctly, false otherwise.
+	**/
+	bool pin_current_to_node(const unsigned node) const {
+#if defined(__linux__)
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for(size_type a = 0; a < cpus.size(); a++)
+			if(cpu_nodes[a] == node)
+				CPU_SET(cpus[a], &set);
+		return CPU_COUNT(&set) > 0 && pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+		(void)node;
+		return false;
+#endif
+	}
+
+private:
+	/** \brief Identifiers of the CPUs the process is allowed to run on. **/
+	std::vector<unsigned> cpus;
+	/** \brief Number of CPUs corresponding to the CPU quota (zero if unlimited). **/
+	size_type quota;
+	/** \brief NUMA node of each of the allowed CPUs. **/
+	std::vector<unsigned> cpu_nodes;
+
+	/**
+	 * \brief Parses a list of identifiers in the format used by sysfs (e.g. "0-3,8,10-11").
+	 * \param list the string to be parsed.
+	 * \return the identifiers contained in the list.
+	**/
+	static std::vector<unsigned> parse_list(const std::string& list) {
+		std::vector<unsigned> values;
+		std::istringstream stream(list);
+		std::string range;
+		while(std::getline(stream, range, ',')) {
+			unsigned first, last;
+			char dash;
+			std::istringstream range_stream(range);
+			if(!(range_stream >> first))
+				continue;
+			last = (range_stream >> dash >> last) ? last : first;
+			for(unsigned value = first; value <= last; value++)
+				values.push_back(value);
+		}
+		return values;
+	}
+
+	/**
+	 * \brief Reads the CPU quota of the control groups the process belongs to.
+	 *
+	 * The groups are read from /proc/self/cgroup and, since the quota of a group also limits
+	 * all its descendants, the strictest quota among each group and its ancestors is used.
+	 * Missing or malformed files are ignored.
+	 *
+	 * \return the number of CPUs corresponding to the quota (rounded up), or zero if unlimited.
+	**/
+	static size_type cgroup_quota() {
+		size_type quota = 0;
+		std::ifstream self_file("/proc/self/cgroup");
+		std::string line;
+		while(std::getline(self_file, line)) {
+			// Each line has the format "hierarchy:controllers:path" (the controllers are empty for cgroup v2)
+			const std::string::size_type first = line.find(':');
+			const std::string::size_type second = (first != std::string::npos) ? line.find(':', first+1) : first;
+			if(second == std::string::npos)
+				continue;
+			const std::string controllers = line.substr(first+1, second-first-1);
+			const std::string path = line.substr(second+1);
+
+			if(controllers.empty())
+				quota = strictest(quota, hierarchy_quota("/sys/fs/cgroup", path, false));
+			else if(("," + controllers + ",").find(",cpu,") != std::string::npos)
+				quota = strictest(quota, hierarchy_quota("/sys/fs/cgroup/cpu", path, true));
+		}
+		return quota;
+	}
+
+	/**
+	 * \brief Reads the strictest CPU quota of a control group and of all its ancestors.
+	 * \param mount the directory where the hierarchy is mounted.
+	 * \param path the path of the group inside the hierarchy.
+	 * \param v1 whether the hierarchy is a cgroup v1 one (otherwise it is a cgroup v2 one).
+	 * \return the number of CPUs corresponding to the quota (rounded up), or zero if unlimited.
+	**/
+	static size_type hierarchy_quota(const std::string& mount, std::string path, const bool v1) {
+		size_type quota = 0;
+		while(!path.empty() && path.back() == '/')
+			path.pop_back();
+		while(true) {
+			quota = strictest(quota, v1 ? read_quota_v1(mount + path) : read_quota_v2(mount + path));
+			if(path.empty())
+				break;
+			path.erase(path.rfind('/'));
+		}
+		return quota;
+	}
+
+	/**
+	 * \brief Reads the CPU quota of a cgroup v2 group (the file contains the quota, or "max", and the period).
+	 * \param directory the directory of the group.
+	 * \return the number of CPUs corresponding to the quota (rounded up), or zero if unlimited or unknown.
+	**/
+	static size_type read_quota_v2(const std::string& directory) {
+		std::ifstream file(directory + "/cpu.max");
+		std::string value;
+		long long limit, period;
+		if(!(file >> value >> period) || value == "max" || period <= 0)
+			return 0;
+		std::istringstream value_stream(value);
+		if(!(value_stream >> limit) || limit <= 0)
+			return 0;
+		return (size_type)std::ceil((double)limit/period);
+	}
+
+	/**
+	 * \brief Reads the CPU quota of a cgroup v1 group (the quota is -1 if unlimited).
+	 * \param directory the directory of the group.
+	 * \return the number of CPUs corresponding to the quota (rounded up), or zero if unlimited or unknown.
+	**/
+	static size_type read_quota_v1(const std::string& directory) {
+		std::ifstream quota_file(directory + "/cpu.cfs_quota_us");
+		std::ifstream period_file(directory + "/cpu.cfs_period_us");
+		long long limit, period;
+		if(quota_file >> limit && period_file >> period && limit > 0 && period > 0)
+			return (size_type)std::ceil((double)limit/period);
+		return 0;
+	}
+
+	/**
+	 * \brief Combines two quotas, returning the strictest one.
+	 * \param a the first quota (zero if unlimited).
+	 * \param b the second quota (zero if unlimited).
+	 * \return the strictest quota (zero if both are unlimited).
+	**/
+	static inline size_type strictest(const size_type a, const size_type b) {
+		if(a == 0 || b == 0)
+			return a + b;
+		return std::min(a, b);
+	}
+};
+
+#endif
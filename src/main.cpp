@@ -14,12 +14,27 @@
 // along with CoIoTeSolver. If not, see <http://www.gnu.org/licenses/>.
 
 
+#include <cstdlib>
+#include <future>
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <vector>
 
 #include "coiote_solver.h"
+#include "mapped_file.h"
+#include "solver_server.h"
 
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+coiote_solver* load_instance(const std::string& path, const coiote_solver::settings& config);
+void solve_instance(coiote_solver& solver, const std::string& path, const unsigned time_limit_ms,
+	std::ofstream& output_file, const std::string& solution_path, const bool test);
+int solve_batch(const std::string& list_path, const unsigned time_limit_ms, std::ofstream& output_file,
+	const std::string& solution_dir, const coiote_solver::settings& config, const bool test);
 void print_help(std::string exe_name);
 void print_version();
 
@@ -29,6 +44,11 @@ int main(int argc, char **argv) {
 	const int max_files = 3; // Maximum number of files accepted as parameters
 
 	bool test = false;
+	bool convert = false;
+	bool batch = false;
+	bool server = false;
+	std::string socket_path;
+	coiote_solver::settings config;
 	size_t nfiles = 0;
 	std::string file_paths[max_files];
 
@@ -49,6 +69,60 @@ int main(int argc, char **argv) {
 		// Enable the feasibility test of the solution
 		else if(arg == "--test")
 			test = true;
+		// Convert the input file into the binary format instead of solving it
+		else if(arg == "--convert")
+			convert = true;
+		// Solve all the instances listed in the input file
+		else if(arg == "--batch")
+			batch = true;
+		// Serve the requests read from the standard input
+		else if(arg == "--server")
+			server = true;
+		// Serve the requests received on a Unix socket
+		else if(arg == "--socket") {
+			if(i+1 >= argc) {
+				print_help(argv[0]);
+				return -1;
+			}
+			socket_path = argv[++i];
+			server = true;
+		}
+		// Set the number of threads to be used
+		else if(arg == "--threads") {
+			int n_threads = (i+1 < argc) ? std::atoi(argv[++i]) : 0;
+			if(n_threads <= 0) {
+				print_help(argv[0]);
+				return -1;
+			}
+			config.n_threads = config.n_load_threads = n_threads;
+		}
+		// Pin the threads solving the problem to the allowed CPUs
+		else if(arg == "--pin")
+			config.pin_threads = true;
+		// Stop the search as soon as it converges instead of using all the available time
+		else if(arg == "--adaptive") {
+			double stop_gain = (i+1 < argc) ? std::atof(argv[++i]) : 0;
+			if(stop_gain <= 0) {
+				print_help(argv[0]);
+				return -1;
+			}
+			config.stop_gain = stop_gain;
+		}
+		// Stop the search as soon as the solution is close enough to the lower bound
+		else if(arg == "--gap") {
+			double gap_tolerance = (i+1 < argc) ? std::atof(argv[++i]) : 0;
+			if(gap_tolerance <= 0) {
+				print_help(argv[0]);
+				return -1;
+			}
+			config.gap_tolerance = gap_tolerance;
+		}
+		// Raise the lower bound through a Lagrangian relaxation, in order to report a tighter gap
+		else if(arg == "--bound")
+			config.lagrangian_bound = true;
+		// Replicate the instance data on each NUMA node used by the threads
+		else if(arg == "--numa")
+			config.numa_replicas = true;
 		// Add the parameter to the file list
 		else {
 			if(nfiles >= max_files) {
@@ -59,56 +133,101 @@ int main(int argc, char **argv) {
 		}
 	}
 
+	// In server mode, keep a solver resident and serve the requests until asked to stop
+	if(server) {
+		if(nfiles != 0 || convert || batch) {
+			print_help(argv[0]);
+			return -1;
+		}
+
+		solver_server resident(config);
+		if(socket_path.empty()) {
+#if defined(_WIN32)
+			// The size of the instances is expressed in bytes, hence no translation must occur
+			_setmode(_fileno(stdin), _O_BINARY);
+#endif
+			resident.serve(stdin, stdout);
+		}
+		else if(!resident.listen(socket_path)) {
+			std::cerr << "Impossible to listen on socket " << socket_path << std::endl;
+			return -3;
+		}
+		return 0;
+	}
+
 	// In case the number of files specified as parameters is wrong, abort the execution
-	if(nfiles < min_files || nfiles > max_files) {
+	if(nfiles < min_files || nfiles > max_files || (convert && (nfiles != min_files || batch))) {
 		print_help(argv[0]);
 		return -1;
 	}
 
-	// Open the input stream to read the instance of the problem
-	std::ifstream input_file(file_paths[0]);
-	// Open the output stream (append mode) to save the KPIs of the solution
-	std::ofstream output_file(file_paths[1], std::ios::app);
+	// In batch mode, solve all the listed instances appending their KPIs to the same output file
+	if(batch) {
+		std::ofstream output_file(file_paths[1], std::ios::app);
+		if(!output_file.is_open()) {
+			std::cerr << "Impossible to open output file " << file_paths[1] << std::endl;
+			return -3;
+		}
+		return solve_batch(file_paths[0], time_limit_ms, output_file, file_paths[2], config, test);
+	}
 
-	// Check if both files have been opened correctly
-	if(!input_file.is_open()) {
-		std::cerr << "Impossible to open input file " << file_paths[0] << std::endl;
+	// Load the instance of the problem (either in the text or in the binary format)
+	coiote_solver* solver = load_instance(file_paths[0], config);
+	if(solver == nullptr) {
 		return -2;
 	}
+
+	// In conversion mode, write the instance in the binary format and exit
+	if(convert) {
+		std::ofstream instance_file(file_paths[1], std::ios::binary);
+		if(!instance_file.is_open()) {
+			std::cerr << "Impossible to open output file " << file_paths[1] << std::endl;
+			delete(solver);
+			return -3;
+		}
+		solver->write_instance(instance_file);
+		instance_file.close();
+		delete(solver);
+		return 0;
+	}
+
+	// Open the output stream (append mode) to save the KPIs of the solution
+	std::ofstream output_file(file_paths[1], std::ios::app);
 	if(!output_file.is_open()) {
 		std::cerr << "Impossible to open output file " << file_paths[1] << std::endl;
+		delete(solver);
 		return -3;
 	}
 
-	// Read from the input file the instance 'sizes'
-	unsigned n_cells, n_timesteps, n_usertypes;
-	input_file >> n_cells;
-	input_file >> n_timesteps;
-	input_file >> n_usertypes;
+	// Do the real work: solve the problem
+	solve_instance(*solver, file_paths[0], time_limit_ms, output_file, file_paths[2], test);
+	output_file.close();
 
-	// Initiate the solver class and close the input file
-	coiote_solver solver(input_file, n_cells, n_timesteps, n_usertypes);
-	input_file.close();
+	delete(solver);
+	return 0;
+}
+
+void solve_instance(coiote_solver& solver, const std::string& path, const unsigned time_limit_ms,
+	std::ofstream& output_file, const std::string& solution_path, const bool test) {
 
-	// Do the real work: solve the problem
 	solver.solve(time_limit_ms);
 
 	// Write the KPIs to the output file after having got the instance file name as identifier
-	std::string input_filename = file_paths[0].substr(file_paths[0].find_last_of("/\\") + 1);
+	std::string input_filename = path.substr(path.find_last_of("/\\") + 1);
 	std::string instance_name = input_filename.substr(0, input_filename.find_last_of('.'));
 	solver.write_kpi(output_file, instance_name);
-	output_file.close();
+	output_file.flush();
 
 	// In the case a file where writing the whole solution has been specified,
 	// try to open it and then, if possible, save the solution
-	if(nfiles == max_files) {
-		std::ofstream solution_file(file_paths[2]);
+	if(!solution_path.empty()) {
+		std::ofstream solution_file(solution_path);
 		if(solution_file.is_open()) {
 			solver.write_solution(solution_file);
 			solution_file.close();
 		}
 		else
-			std::cerr << "Impossible to open solution file " << file_paths[2] << std::endl;
+			std::cerr << "Impossible to open solution file " << solution_path << std::endl;
 	}
 
 	// If the feasibility test has been enabled, execute it and then report the result
@@ -131,17 +250,114 @@ int main(int argc, char **argv) {
 				break;
 		}
 	}
+}
 
-	return 0;
+int solve_batch(const std::string& list_path, const unsigned time_limit_ms, std::ofstream& output_file,
+	const std::string& solution_dir, const coiote_solver::settings& config, const bool test) {
+
+	// Read the paths of the instances, one per line (empty lines and the ones starting with '#' are skipped)
+	std::ifstream list_file(list_path);
+	if(!list_file.is_open()) {
+		std::cerr << "Impossible to open input file " << list_path << std::endl;
+		return -2;
+	}
+	std::vector<std::string> paths;
+	std::string line;
+	while(std::getline(list_file, line)) {
+		line.erase(line.find_last_not_of(" \t\r") + 1);
+		if(!line.empty() && line[0] != '#')
+			paths.push_back(line);
+	}
+	if(paths.empty())
+		return 0;
+
+	// Each instance is loaded while the previous one is being solved: since the solution time is
+	// limited, the overlapped loads are performed by a single thread, leaving the CPUs to the solver
+	coiote_solver::settings overlapped_config = config;
+	overlapped_config.n_load_threads = 1;
+
+	int result = 0;
+	std::future<coiote_solver*> next = std::async(std::launch::async, load_instance, paths[0], config);
+	for(size_t k = 0; k < paths.size(); k++) {
+		coiote_solver* solver = next.get();
+		if(k+1 < paths.size())
+			next = std::async(std::launch::async, load_instance, paths[k+1], overlapped_config);
+		if(solver == nullptr) {
+			result = -2;
+			continue;
+		}
+
+		std::string input_filename = paths[k].substr(paths[k].find_last_of("/\\") + 1);
+		if(test)
+			std::cout << input_filename << ": " << std::flush;
+		solve_instance(*solver, paths[k], time_limit_ms, output_file,
+			solution_dir.empty() ? solution_dir : solution_dir + "/" + input_filename, test);
+		delete(solver);
+	}
+	return result;
+}
+
+coiote_solver* load_instance(const std::string& path, const coiote_solver::settings& config) {
+	// Map the input file, in order to check whether it is stored in the binary format
+	mapped_file file(path);
+	if(!file.is_open()) {
+		std::cerr << "Impossible to open input file " << path << std::endl;
+		return nullptr;
+	}
+
+	if(binary_instance::is_binary(file)) {
+		binary_instance instance(file);
+		if(!instance.is_valid()) {
+			std::cerr << "Corrupted binary input file " << path << std::endl;
+			return nullptr;
+		}
+		return new coiote_solver(instance, config);
+	}
+
+	// Otherwise scan the mapped file to read the instance in the text format
+	try {
+		text_scanner input(file.data(), file.data() + file.size());
+
+		// Read from the input file the instance 'sizes'
+		unsigned n_cells = input.read_int();
+		unsigned n_timesteps = input.read_int();
+		unsigned n_usertypes = input.read_int();
+
+		// Initiate the solver class
+		return new coiote_solver(input, n_cells, n_timesteps, n_usertypes, config);
+	}
+	catch(const parse_error& error) {
+		std::cerr << "Malformed input file " << path << ":" << error.what() << std::endl;
+		return nullptr;
+	}
 }
 
 void print_help(std::string exe_name) {
 	std::cerr << "Usage: " << exe_name << " [Options] InputFile OutputFile [SolutionFile]" << std::endl;
+	std::cerr << "       " << exe_name << " [Options] --batch ListFile OutputFile [SolutionDir]" << std::endl;
 	std::cerr << " * InputFile: path of the input file describing the problem instance" << std::endl;
 	std::cerr << " * OutputFile: path of the file to which append a summary of the solution" << std::endl;
 	std::cerr << " * SolutionFile: path of the file where store the complete solution (optional)" << std::endl;
+	std::cerr << " * ListFile: path of a file listing the input files to be solved, one per line" << std::endl;
+	std::cerr << " * SolutionDir: directory where store the complete solutions, named as the input files (optional)" << std::endl;
+	std::cerr << "       " << exe_name << " [Options] --server | --socket Path" << std::endl;
+	std::cerr << "   Keeps a solver resident, serving the requests read from the standard input or a Unix socket:" << std::endl;
+	std::cerr << "   'SOLVE TimeLimitMs Size [Name]' followed by the instance (Size bytes), 'SET_ACTIVITIES j Value'," << std::endl;
+	std::cerr << "   'SET_USERS i m t Value', 'RESOLVE TimeLimitMs [Name]' (warm start from the last solution) or 'QUIT'" << std::endl;
+	std::cerr << "   (--socket is available only on POSIX systems)" << std::endl;
 	std::cerr << "Options:" << std::endl;
 	std::cerr << " * --test: parameter which enables some tests of correctness" << std::endl;
+	std::cerr << " * --convert: converts InputFile into the binary format, writing it to OutputFile" << std::endl;
+	std::cerr << " * --batch: solves all the input files listed in ListFile, loading each one while solving the previous" << std::endl;
+	std::cerr << " * --threads N: number of threads to be used (default: number of CPUs available)" << std::endl;
+	std::cerr << " * --pin: pins the threads solving the problem to the available CPUs" << std::endl;
+	std::cerr << " * --adaptive G: stops as soon as the gain expected in the remaining time is lower than the fraction G" << std::endl;
+	std::cerr << "   of the objective function (e.g. 0.001), instead of always using all the available time" << std::endl;
+	std::cerr << " * --gap T: stops as soon as the gap between the objective function and its lower bound is not greater" << std::endl;
+	std::cerr << "   than the fraction T of the objective function (e.g. 0.01), computing the bound as with --bound" << std::endl;
+	std::cerr << " * --bound: raises the lower bound used to report the gap through a Lagrangian relaxation, which takes" << std::endl;
+	std::cerr << "   the place of one of the threads (if more than one)" << std::endl;
+	std::cerr << " * --numa: replicates the instance data on each NUMA node (implies --pin)" << std::endl;
 	std::cerr << " * --help: shows this help" << std::endl;
 	std::cerr << " * --version: shows information about this program" << std::endl;
 }
@@ -0,0 +1,149 @@
+// This file is part of CoIoTeSolver.
+
+// CoIoTeSolver is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CoIoTeSolver is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with CoIoTeSolver. If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <fstream>
+#include <iterator>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * \brief This class provides a read-only view of the whole content of a file.
+ *
+ * On POSIX systems a regular file is mapped into memory through mmap, so that no copy
+ * is performed and the pages are loaded lazily by the operating system. The other kinds
+ * of files (e.g. pipes, FIFOs or process substitutions), whose size is not known in
+ * advance, are read into a buffer until their end, as it is done for all the files on
+ * other systems (i.e. Windows).
+ *
+ * The mapping is released when the object is destroyed.
+**/
+class mapped_file {
+public:
+	/** \brief size_type is defined as an alias of size_t, an unsigned integral type. **/
+	typedef size_t size_type;
+
+	/**
+	 * \brief Constructor.
+	 *
+	 * Opens the file specified as parameter and maps it into memory. In case of
+	 * failure, is_open() returns false.
+	 *
+	 * \param path the path of the file to be opened.
+	**/
+	explicit mapped_file(const std::string& path) : _data(nullptr), _size(0), _open(false), _mapped(false) {
+#if defined(_WIN32)
+		std::ifstream file(path, std::ios::binary);
+		if(!file.is_open())
+			return;
+		buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		_data = buffer.data();
+		_size = buffer.size();
+		_open = true;
+#else
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if(fd < 0)
+			return;
+
+		struct stat st;
+		if(fstat(fd, &st) == 0) {
+			if(!S_ISREG(st.st_mode)) {
+				// The size is not known in advance, hence the content is read in chunks until the end
+				const size_type chunk_size = 64*1024;
+				ssize_t n_read;
+				do {
+					buffer.resize(_size + chunk_size);
+					while((n_read = ::read(fd, buffer.data() + _size, chunk_size)) < 0 && errno == EINTR) {}
+					if(n_read > 0)
+						_size += n_read;
+				} while(n_read > 0);
+				buffer.resize(_size);
+				_data = buffer.data();
+				_open = (n_read == 0);
+			}
+			else if((_size = st.st_size) == 0) {
+				_open = true;
+			}
+			else {
+				void* addr = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+				if(addr != MAP_FAILED) {
+					madvise(addr, _size, MADV_SEQUENTIAL);
+					_data = static_cast<const char*>(addr);
+					_open = _mapped = true;
+				}
+			}
+		}
+		::close(fd);
+#endif
+	}
+
+	/**
+	 * \brief Destructor.
+	**/
+	~mapped_file() {
+#if !defined(_WIN32)
+		if(_mapped)
+			munmap(const_cast<char*>(_data), _size);
+#endif
+	}
+
+	mapped_file(const mapped_file&) = delete;
+	mapped_file& operator=(const mapped_file&) = delete;
+
+	/**
+	 * \brief Returns whether the file has been opened (and mapped) correctly.
+	 * \return boolean value.
+	**/
+	inline bool is_open() const { return _open; }
+
+	/**
+	 * \brief Returns a pointer to the first byte of the file.
+	 * \return pointer to the content of the file.
+	**/
+	inline const char* data() const { return _data; }
+
+	/**
+	 * \brief Returns the size in bytes of the file.
+	 * \return size of the file.
+	**/
+	inline size_type size() const { return _size; }
+
+private:
+	/** \brief Pointer to the first byte of the file. **/
+	const char* _data;
+	/** \brief Size in bytes of the file. **/
+	size_type _size;
+	/** \brief Boolean variable specifying if the file has been opened correctly. **/
+	bool _open;
+	/** \brief Boolean variable specifying if the file has been mapped into memory (otherwise it is stored in the buffer). **/
+	bool _mapped;
+
+	/** \brief Buffer storing the content of the file, if it has not been mapped. **/
+	std::vector<char> buffer;
+};
+
+#endif
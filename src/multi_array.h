@@ -19,8 +19,11 @@
 
 #include <algorithm>
 #include <array>
+#include <utility>
 #include <vector>
 
+#include "array_allocation.h"
+
 /**
  * \brief This class provides an efficient and easy to use implementation of multi-dimensional arrays.
  *
@@ -32,13 +35,23 @@
  * operator[] that, given an index of the correct type, is able to retrieve the desired element without
  * having to manage with complex and error-prone offset calculations.
  *
+ * By default the elements are stored in row-major order (i.e. the last dimension varies fastest),
+ * but a different layout can be specified at construction time, as a permutation of the dimensions
+ * from the outermost to the innermost one. In this way the elements most often accessed together can
+ * be stored contiguously, without having to modify the indexes used to access them. The offset of
+ * each element is computed through the strides of the dimensions, cached at construction time.
+ *
+ * The memory is obtained through the allocation policy specified as template parameter (see
+ * array_allocation.h), which allows e.g. to align large arrays and to back them by huge pages.
+ *
  * Be careful, because, in order to make both instantiation and access as fast as possible,
  * neither boundary check nor correctness controls are performed.
  *
  * \tparam T: Type of elements to be stored into the multi-dimensional array.
  * \tparam N: Number of dimension such container is caracterized by.
+ * \tparam Allocation: Policy used to allocate and release the memory (default_allocation by default).
  **/
-template <class T, size_t N>
+template <class T, size_t N, class Allocation = default_allocation>
 class multi_array {
 
 public:
@@ -47,7 +60,7 @@ public:
 	/** \brief size_type is defined as an alias of size_t, an unsigned integral type. **/
 	typedef size_t size_type;
 	/** \brief container_type is defined as an alias of the type of the current class. **/
-	typedef multi_array<value_type, N> container_type;
+	typedef multi_array<value_type, N, Allocation> container_type;
 
 	/** \brief const_iterator is defined as an alias of const value_type*, a random access iterator to const value_type. **/
 	typedef const value_type* const_iterator;
@@ -63,13 +76,17 @@ public:
 	 * by the parameter. The elements inside the array are not initialized with any value.
 	 *
 	 * \param dimensions an array containing for each dimension the number of elements to be allocated.
+	 * \param layout the dimensions ordered from the outermost to the innermost one in memory
+	 * (by default the row-major order, i.e. {0, 1, ..., N-1}).
 	**/
-	multi_array(const index_type& dimensions) {
+	multi_array(const index_type& dimensions, const index_type& layout = row_major()) {
 		this->size = 1;
-		for(size_type n = 0; n < N; n++)
-			this->size *= dimensions[n];
+		for(size_type n = N; n > 0; n--) {
+			this->strides[layout[n-1]] = this->size;
+			this->size *= dimensions[layout[n-1]];
+		}
 		this->dimensions = dimensions;
-		data = new value_type[this->size];
+		data = Allocation::template allocate<value_type>(this->size);
 	}
 
 	/**
@@ -82,15 +99,30 @@ public:
 	multi_array(const container_type& other) {
 		this->size = other.size;
 		this->dimensions = other.dimensions;
-		this->data = new value_type[this->size];
+		this->strides = other.strides;
+		this->data = Allocation::template allocate<value_type>(this->size);
 		std::copy(other.begin(), other.end(), this->begin());
 	}
 
+	/**
+	 * \brief Move Constructor.
+	 *
+	 * Constructs a container acquiring the elements of other, without copying them.
+	 * The other container is left empty (it can only be destroyed or assigned).
+	 *
+	 * \param other another container of the same type (with the same class template arguments T and N).
+	**/
+	multi_array(container_type&& other) : data(other.data), size(other.size),
+		dimensions(other.dimensions), strides(other.strides) {
+			other.data = nullptr;
+			other.size = 0;
+	}
+
 	/**
 	 * \brief Destructor
 	**/
 	~multi_array() {
-		delete[](this->data);
+		Allocation::deallocate(this->data);
 	}
 
 	/**
@@ -101,7 +133,8 @@ public:
 	 * The objects must be of same type and must have the same number of dimensions but can have different
 	 * number of elements for each dimension. If the two containers are caracterized by the same number of
 	 * elements per dimension, the elements are simply copied, while in the opposite case the old container
-	 * is destroyed and a brand new one is then allocated and the elements are copied.
+	 * is destroyed and a brand new one is then allocated and the elements are copied. In both cases the
+	 * layout of the other container is adopted.
 	 *
 	 * \param other another container of the same type (with the same class template arguments T and N).
 	**/
@@ -111,15 +144,32 @@ public:
 				this->size = other.size;
 				this->dimensions = other.dimensions;
 
-				delete[](this->data);
-				data = new value_type[this->size];
+				Allocation::deallocate(this->data);
+				data = Allocation::template allocate<value_type>(this->size);
 			}
+			this->strides = other.strides;
 
 			std::copy(other.begin(), other.end(), this->begin());
 		}
 		return *this;
 	};
 
+	/**
+	 * \brief Assigns new contents to the container, acquiring the elements of other without copying them.
+	 *
+	 * The contents of the two containers are exchanged, so that the old elements are released
+	 * when the other container is destroyed.
+	 *
+	 * \param other another container of the same type (with the same class template arguments T and N).
+	**/
+	container_type& operator=(container_type&& other) {
+		std::swap(this->data, other.data);
+		std::swap(this->size, other.size);
+		std::swap(this->dimensions, other.dimensions);
+		std::swap(this->strides, other.strides);
+		return *this;
+	}
+
 	/**
 	 * \brief Resets the multi-dimensional array.
 	 *
@@ -188,6 +238,17 @@ public:
 	**/
 	inline const_iterator get_iterator(const index_type& index) const { return get(index); }
 
+	/**
+	 * \brief Returns the row-major layout, i.e. the dimensions in their natural order.
+	 * \return the layout {0, 1, ..., N-1}.
+	**/
+	static index_type row_major() {
+		index_type layout;
+		for(size_type n = 0; n < N; n++)
+			layout[n] = n;
+		return layout;
+	}
+
 private:
 	/** \brief Pointer to the first element of the underlying dinamically allocated array. **/
 	iterator data;
@@ -195,6 +256,8 @@ private:
 	size_type size;
 	/** \brief Number of elements for each dimension of the multi-dimensional array. **/
 	index_type dimensions;
+	/** \brief Distance between two consecutive elements for each dimension of the multi-dimensional array. **/
+	index_type strides;
 
 	/**
 	 * \brief Returns an iterator pointing to the element specified by the index.
@@ -208,9 +271,9 @@ private:
 	 * \see get_iterator()
 	**/
 	iterator get(const index_type& index) const {
-		size_type idx = index[0];
+		size_type idx = index[0]*strides[0];
 		for(size_type n = 1; n < N; n++)
-			idx = idx*dimensions[n] + index[n];
+			idx += index[n]*strides[n];
 		return (data+idx);
 	}
 };
@@ -0,0 +1,291 @@
+// This file is part of CoIoTeSolver.
+
+// CoIoTeSolver is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CoIoTeSolver is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with CoIoTeSolver. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <sstream>
+
+#if !defined(_WIN32)
+#include <cerrno>
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "solver_server.h"
+
+void solver_server::serve(FILE* input, FILE* output) {
+	std::string line;
+	while(!stopped && read_line(input, line)) {
+		std::istringstream request(line);
+		std::string command;
+		request >> command;
+
+		// Ignore the empty lines
+		if(command.empty())
+			continue;
+
+		if(command == "QUIT") {
+			stopped = true;
+			respond(output, "OK\n");
+			break;
+		}
+		if(command == "SET_ACTIVITIES" || command == "SET_USERS") {
+			respond(output, update_instance(command, request) ? "OK\n" : "ERROR malformed request\n");
+			continue;
+		}
+		if(command == "RESOLVE") {
+			long long time_limit_ms;
+			std::string name;
+			if(!(request >> time_limit_ms) || time_limit_ms <= 0 || solver == nullptr) {
+				respond(output, "ERROR malformed request\n");
+				continue;
+			}
+			if(!(request >> name))
+				name = "instance";
+			respond(output, solution_response(solver->resolve(time_limit_ms), name));
+			continue;
+		}
+		if(command != "SOLVE") {
+			respond(output, "ERROR unknown command " + command + "\n");
+			continue;
+		}
+
+		// Parse the parameters of the request (the name is optional)
+		long long time_limit_ms, size;
+		std::string name;
+		if(!(request >> time_limit_ms >> size) || time_limit_ms <= 0 || size < 0) {
+			respond(output, "ERROR malformed request\n");
+			continue;
+		}
+		if(!(request >> name))
+			name = "instance";
+
+		// Receive the instance: if it cannot be stored it is skipped, so that the following requests can still
+		// be served, while if it is incomplete the stream is not usable anymore
+		if(!allocate_buffer(size)) {
+			const bool complete = skip_payload(input, size);
+			respond(output, complete ? "ERROR the instance is too large\n" : "ERROR incomplete instance\n");
+			if(!complete)
+				break;
+			continue;
+		}
+		if(size > 0 && std::fread(buffer.data(), 1, size, input) != (size_type)size) {
+			respond(output, "ERROR incomplete instance\n");
+			break;
+		}
+
+		const std::string error = load_instance();
+		if(!error.empty()) {
+			respond(output, "ERROR " + error + "\n");
+			continue;
+		}
+
+		// Do the real work: solve the problem and send back the KPIs and the solution
+		respond(output, solution_response(solver->solve(time_limit_ms), name));
+	}
+}
+
+bool solver_server::listen(const std::string& path) {
+#if defined(_WIN32)
+	(void)path;
+	return false;
+#else
+	sockaddr_un address;
+	std::memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if(path.size() >= sizeof(address.sun_path))
+		return false;
+	std::strcpy(address.sun_path, path.c_str());
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(fd < 0)
+		return false;
+	unlink(path.c_str());
+	if(bind(fd, (sockaddr*)&address, sizeof(address)) != 0 || ::listen(fd, 8) != 0) {
+		close(fd);
+		return false;
+	}
+
+	// A client closing the connection before reading the response must not terminate the server
+	std::signal(SIGPIPE, SIG_IGN);
+
+	// Serve the connections one at a time, since each request already uses all the threads
+	while(!stopped) {
+		int connection = accept(fd, nullptr, nullptr);
+		if(connection < 0) {
+			if(errno == EINTR)
+				continue;
+			break;
+		}
+
+		FILE* input = fdopen(connection, "rb");
+		FILE* output = (input != nullptr) ? fdopen(dup(connection), "wb") : nullptr;
+		if(output != nullptr)
+			serve(input, output);
+
+		if(output != nullptr)
+			std::fclose(output);
+		if(input != nullptr)
+			std::fclose(input);
+		else
+			close(connection);
+	}
+
+	close(fd);
+	unlink(path.c_str());
+	return true;
+#endif
+}
+
+bool solver_server::update_instance(const std::string& command, std::istream& request) {
+	long long values[4];
+	const size_type n_values = (command == "SET_USERS") ? 4 : 2;
+	for(size_type a = 0; a < n_values; a++)
+		if(!(request >> values[a]) || values[a] < 0 || values[a] > std::numeric_limits<int>::max())
+			return false;
+
+	if(solver == nullptr)
+		return false;
+	if(n_values == 2)
+		return solver->set_activities(values[0], values[1]);
+	return solver->set_users_available(values[0], values[1], values[2], values[3]);
+}
+
+std::string solver_server::solution_response(const bool solved, const std::string& name) {
+	std::ostringstream response;
+	if(solved) {
+		response << "OK" << std::endl;
+		solver->write_kpi(response, name);
+		solver->write_solution(response);
+	}
+	else
+		response << "NO_SOLUTION" << std::endl;
+	return response.str();
+}
+
+std::string solver_server::load_instance() {
+	const char* data = buffer.data();
+	const size_type size = buffer.size();
+
+	try {
+		if(binary_instance::is_binary(data, size)) {
+			binary_instance instance(data, size);
+			if(!instance.is_valid())
+				return "corrupted binary instance";
+			if(instance.n_cells() == 0 || instance.n_time_steps() == 0 || instance.n_cust_types() == 0)
+				return "malformed instance: the dimensions must be positive";
+
+			// If the dimensions are different, the resident solver is released before creating the new one
+			if(solver == nullptr || !solver->reload(instance)) {
+				delete(solver);
+				solver = nullptr;
+				solver = new coiote_solver(instance, config);
+			}
+			return "";
+		}
+
+		text_scanner input(data, data + size);
+
+		// Read from the instance the 'sizes'
+		unsigned n_cells = input.read_int();
+		unsigned n_timesteps = input.read_int();
+		unsigned n_usertypes = input.read_int();
+		if(n_cells == 0 || n_timesteps == 0 || n_usertypes == 0)
+			return "malformed instance: the dimensions must be positive";
+
+		// Reject the dimensions which cannot be described by the payload, before allocating anything
+		if(!fits_text_payload(n_cells, n_timesteps, n_usertypes, size))
+			return "malformed instance: the dimensions do not match the size";
+
+		if(solver == nullptr || !solver->reload(input, n_cells, n_timesteps, n_usertypes)) {
+			delete(solver);
+			solver = nullptr;
+			solver = new coiote_solver(input, n_cells, n_timesteps, n_usertypes, config);
+		}
+		return "";
+	}
+	catch(const parse_error& error) {
+		// The resident solver may have been partially overwritten, hence it is discarded
+		delete(solver);
+		solver = nullptr;
+		return std::string("malformed instance: ") + error.what();
+	}
+	catch(const std::exception& error) {
+		// E.g. the memory is not enough: the request fails, but the server keeps serving the following ones
+		delete(solver);
+		solver = nullptr;
+		return std::string("cannot load the instance: ") + error.what();
+	}
+}
+
+bool solver_server::allocate_buffer(const long long size) {
+	if(size > max_instance_size)
+		return false;
+	try {
+		buffer.resize(size);
+	}
+	catch(const std::exception&) {
+		// E.g. the memory is not enough: the buffer is released, to be allocated again by the next request
+		std::vector<char>().swap(buffer);
+		return false;
+	}
+	return true;
+}
+
+bool solver_server::fits_text_payload(const size_type n_cells, const size_type n_timesteps,
+		const size_type n_usertypes, const size_type size) {
+	// Each value takes at least two bytes (a digit and a separator), apart from the last one
+	const size_type max_values = size/2 + 1;
+	const size_type factors[] = { n_cells, n_timesteps, n_usertypes };
+	size_type n_costs = n_cells;
+	for(size_type a = 0; a < 3; a++) {
+		if(factors[a] != 0 && n_costs > max_values/factors[a])
+			return false;
+		n_costs *= factors[a];
+	}
+	return true;
+}
+
+bool solver_server::skip_payload(FILE* input, long long size) {
+	char chunk[65536];
+	while(size > 0) {
+		const size_type length = (size_type)std::min<long long>(size, sizeof(chunk));
+		if(std::fread(chunk, 1, length, input) != length)
+			return false;
+		size -= length;
+	}
+	return true;
+}
+
+bool solver_server::read_line(FILE* input, std::string& line) {
+	line.clear();
+	int c;
+	while((c = std::fgetc(input)) != EOF && c != '\n')
+		line.push_back((char)c);
+	if(!line.empty() && line.back() == '\r')
+		line.pop_back();
+	return c != EOF || !line.empty();
+}
+
+void solver_server::respond(FILE* output, const std::string& response) {
+	std::fwrite(response.data(), 1, response.size(), output);
+	std::fputs("END\n", output);
+	std::fflush(output);
+}
@@ -0,0 +1,171 @@
+// This file is part of CoIoTeSolver.
+
+// CoIoTeSolver is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CoIoTeSolver is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with CoIoTeSolver. If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef SOLVER_SERVER_H
+#define SOLVER_SERVER_H
+
+#include <cstdio>
+#include <istream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "coiote_solver.h"
+
+/**
+ * \brief This class implements a long-running server which solves the instances submitted by its clients.
+ *
+ * A single coiote_solver object is kept resident and, when a new instance has the same dimensions of
+ * the previous one, it is reloaded into the data structures already allocated instead of building new
+ * ones. The requests are read from a stream (e.g. the standard input or a connection accepted on a
+ * Unix socket) and each of them receives a response on the corresponding output stream.
+ *
+ * The protocol is line based:
+ * - "SOLVE <time_limit_ms> <size> [name]" followed by exactly size bytes containing the instance
+ * (either in the text or in the binary format): the instance is solved and the response is the
+ * line "OK", followed by the KPIs line (see coiote_solver::write_kpi(), using the given name or
+ * "instance") and by the whole solution (see coiote_solver::write_solution());
+ * - "SET_ACTIVITIES <j> <activities>" and "SET_USERS <i> <m> <t> <users>": the last instance received
+ * is modified (see coiote_solver::set_activities() and coiote_solver::set_users_available()) and the
+ * response is an empty "OK";
+ * - "RESOLVE <time_limit_ms> [name]": the modified instance is solved again starting from the last
+ * solution (see coiote_solver::resolve()), with the same response of "SOLVE";
+ * - "QUIT": the server is stopped, after having responded with an empty "OK".
+ *
+ * If no solution is found, the response is "NO_SOLUTION", while in case of errors it is "ERROR"
+ * followed by a description. Every response is terminated by a line containing only "END".
+**/
+class solver_server {
+public:
+	/** \brief size_type is defined as an alias of size_t, an unsigned integral type. **/
+	typedef size_t size_type;
+
+	/**
+	 * \brief Constructor.
+	 * \param config the parameters of the solvers.
+	**/
+	explicit solver_server(const coiote_solver::settings& config) : config(config), solver(nullptr), stopped(false) {}
+
+	/**
+	 * \brief Destructor.
+	**/
+	~solver_server() { delete(solver); }
+
+	solver_server(const solver_server&) = delete;
+	solver_server& operator=(const solver_server&) = delete;
+
+	/**
+	 * \brief Serves the requests read from the input stream until its end or until the server is stopped.
+	 * \param input the stream from which the requests are read.
+	 * \param output the stream to which the responses are written.
+	**/
+	void serve(FILE* input, FILE* output);
+
+	/**
+	 * \brief Listens on a Unix socket, serving the connections one at a time until the server is stopped.
+	 *
+	 * The socket file is created (replacing any existing one) and removed when the server is stopped.
+	 * This mode is available only on POSIX systems.
+	 *
+	 * \param path the path of the socket file.
+	 * \return false if the socket cannot be created, true otherwise.
+	**/
+	bool listen(const std::string& path);
+
+	/**
+	 * \brief Returns whether the server has been stopped by a request.
+	 * \return boolean value.
+	**/
+	inline bool is_stopped() const { return stopped; }
+
+private:
+	/** \brief The parameters of the solvers. **/
+	const coiote_solver::settings config;
+	/** \brief The resident solver, linked to the last instance received (nullptr if none). **/
+	coiote_solver* solver;
+	/** \brief Buffer storing the instance currently received. **/
+	std::vector<char> buffer;
+	/** \brief Maximum size in bytes of an instance received by a request. **/
+	static const long long max_instance_size = std::numeric_limits<int>::max();
+	/** \brief Boolean variable specifying whether the server has been stopped by a request. **/
+	bool stopped;
+
+	/**
+	 * \brief Resizes the buffer in order to store an instance of the given size.
+	 * \param size size in bytes of the instance.
+	 * \return false if the size exceeds max_instance_size or the memory is not enough, true otherwise.
+	**/
+	bool allocate_buffer(const long long size);
+
+	/**
+	 * \brief Loads the instance stored in the buffer, reusing the resident solver if possible.
+	 * \return a description of the error, or an empty string if the instance has been loaded.
+	**/
+	std::string load_instance();
+
+	/**
+	 * \brief Applies a change to the last instance received.
+	 * \param command the name of the request (either "SET_ACTIVITIES" or "SET_USERS").
+	 * \param request the stream containing the parameters of the request.
+	 * \return false if the request is malformed or no instance has been received, true otherwise.
+	**/
+	bool update_instance(const std::string& command, std::istream& request);
+
+	/**
+	 * \brief Builds the response to a request solving the instance.
+	 * \param solved whether a solution has been found.
+	 * \param name the identifier of the instance, used for the KPIs.
+	 * \return the content of the response.
+	**/
+	std::string solution_response(const bool solved, const std::string& name);
+
+	/**
+	 * \brief Checks whether an instance in the text format with the given dimensions can fit in the payload,
+	 * considering only the size of its cost matrix.
+	 * \param n_cells number of cells.
+	 * \param n_timesteps number of time periods.
+	 * \param n_usertypes number of customer types.
+	 * \param size size in bytes of the payload.
+	 * \return boolean value.
+	**/
+	static bool fits_text_payload(const size_type n_cells, const size_type n_timesteps,
+		const size_type n_usertypes, const size_type size);
+
+	/**
+	 * \brief Discards the payload of a request from the input stream.
+	 * \param input the stream from which the payload is read.
+	 * \param size size in bytes of the payload.
+	 * \return false if the end of the stream has been reached before the end of the payload, true otherwise.
+	**/
+	static bool skip_payload(FILE* input, long long size);
+
+	/**
+	 * \brief Reads a line from the input stream (the new line character is discarded).
+	 * \param input the stream from which the line is read.
+	 * \param line set to the line read.
+	 * \return false if the end of the stream has been reached before reading anything, true otherwise.
+	**/
+	static bool read_line(FILE* input, std::string& line);
+
+	/**
+	 * \brief Writes a response to the output stream, terminating and flushing it.
+	 * \param output the stream to which the response is written.
+	 * \param response the content of the response.
+	**/
+	static void respond(FILE* output, const std::string& response);
+};
+
+#endif
@@ -0,0 +1,152 @@
+// This file is part of CoIoTeSolver.
+
+// CoIoTeSolver is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CoIoTeSolver is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with CoIoTeSolver. If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef SPARSE_SOLUTION_H
+#define SPARSE_SOLUTION_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "multi_array.h"
+
+/**
+ * \brief This class provides a sparse representation of a solution of the problem.
+ *
+ * A solution is a four dimensional array storing, for each source cell, destination cell,
+ * user type and time period, the number of users moved. Since only a very limited number of
+ * elements is different from zero, only those elements (i.e. the moves) are stored, in a
+ * contiguous list, together with an hash table which associates to each index its position
+ * inside the list.
+ *
+ * In this way, both copying and resetting a solution take a time proportional to the
+ * number of moves and not to the size of the instance. On the other hand, the order of
+ * the moves inside the list is not specified.
+**/
+class sparse_solution {
+public:
+	/** \brief size_type is defined as an alias of size_t, an unsigned integral type. **/
+	typedef size_t size_type;
+	/** \brief index_type represents the index of an element of the solution (i, j, m, t). **/
+	typedef multi_array<int, 4>::index_type index_type;
+
+	/** \brief Data structure representing an element of the solution different from zero. **/
+	struct move {
+		index_type index; /**< \brief Index of the element. **/
+		int users; /**< \brief Number of users moved. **/
+	};
+
+	/** \brief const_iterator is defined as an iterator to constant moves. **/
+	typedef std::vector<move>::const_iterator const_iterator;
+
+	/**
+	 * \brief Constructor. Constructs an empty solution.
+	 * \param dimensions the number of elements of the solution for each dimension.
+	**/
+	sparse_solution(const index_type& dimensions) : dimensions(dimensions) {}
+
+	/**
+	 * \brief Returns the number of users moved for the given index.
+	 * \param index the index referred to the desired element.
+	 * \return number of users (zero if no move is present).
+	**/
+	inline int operator[](const index_type& index) const {
+		std::unordered_map<uint64_t, size_type>::const_iterator it = positions.find(key(index));
+		return (it != positions.end()) ? moves[it->second].users : 0;
+	}
+
+	/**
+	 * \brief Adds the given number of users to the element specified by the index.
+	 *
+	 * If the element becomes zero, the move is removed from the list.
+	 *
+	 * \param index the index referred to the desired element.
+	 * \param users number of users to be added (negative to remove them).
+	 * \return the new number of users of the element.
+	**/
+	int add(const index_type& index, const int users) {
+		const uint64_t k = key(index);
+		std::unordered_map<uint64_t, size_type>::iterator it = positions.find(k);
+		if(it == positions.end()) {
+			if(users != 0) {
+				positions.emplace(k, moves.size());
+				moves.push_back({index, users});
+			}
+			return users;
+		}
+
+		const size_type pos = it->second;
+		const int value = (moves[pos].users += users);
+		if(value == 0) {
+			// Remove the move by replacing it with the last one of the list
+			if(pos != moves.size()-1) {
+				moves[pos] = moves.back();
+				positions[key(moves[pos].index)] = pos;
+			}
+			moves.pop_back();
+			positions.erase(it);
+		}
+		return value;
+	}
+
+	/**
+	 * \brief Resets the solution, removing all the moves.
+	**/
+	inline void clear() {
+		moves.clear();
+		positions.clear();
+	}
+
+	/**
+	 * \brief Returns the number of moves (i.e. elements different from zero).
+	 * \return the number of moves.
+	**/
+	inline size_type size() const { return moves.size(); }
+
+	/**
+	 * \brief Returns a const_iterator pointing to the first move.
+	 * \return const_iterator pointing to the first move.
+	**/
+	inline const_iterator begin() const { return moves.begin(); }
+
+	/**
+	 * \brief Returns a const_iterator pointing to the past-the-end move.
+	 * \return const_iterator pointing to the past-the-end move.
+	**/
+	inline const_iterator end() const { return moves.end(); }
+
+private:
+	/** \brief Number of elements for each dimension of the solution. **/
+	index_type dimensions;
+	/** \brief List of the moves. **/
+	std::vector<move> moves;
+	/** \brief Hash table associating to each index the position of the move inside the list. **/
+	std::unordered_map<uint64_t, size_type> positions;
+
+	/**
+	 * \brief Computes the key associated to an index (i.e. its offset inside the dense array).
+	 * \param index the index.
+	 * \return the key.
+	**/
+	inline uint64_t key(const index_type& index) const {
+		uint64_t k = index[0];
+		for(size_type n = 1; n < index.size(); n++)
+			k = k*dimensions[n] + index[n];
+		return k;
+	}
+};
+
+#endif
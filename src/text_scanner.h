@@ -0,0 +1,192 @@
+// This file is part of CoIoTeSolver.
+
+// CoIoTeSolver is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CoIoTeSolver is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with CoIoTeSolver. If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef TEXT_SCANNER_H
+#define TEXT_SCANNER_H
+
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+/**
+ * \brief Exception thrown by text_scanner when the input does not respect the expected format.
+**/
+class parse_error : public std::runtime_error {
+public:
+	/** \brief size_type is defined as an alias of size_t, an unsigned integral type. **/
+	typedef size_t size_type;
+
+	/**
+	 * \brief Constructor.
+	 * \param message description of the error.
+	 * \param line line (starting from one) where the error has been detected.
+	 * \param column column (starting from one) where the error has been detected.
+	**/
+	parse_error(const std::string& message, const size_type line, const size_type column)
+		: std::runtime_error(std::to_string(line) + ":" + std::to_string(column) + ": " + message),
+			_line(line), _column(column) {}
+
+	/** \brief Returns the line where the error has been detected. **/
+	inline size_type line() const { return _line; }
+	/** \brief Returns the column where the error has been detected. **/
+	inline size_type column() const { return _column; }
+
+private:
+	size_type _line; /**< \brief Line where the error has been detected. **/
+	size_type _column; /**< \brief Column where the error has been detected. **/
+};
+
+/**
+ * \brief This class provides a fast scanner to read integers from a text buffer.
+ *
+ * The scanner works directly on a range of characters (e.g. a memory mapped file),
+ * without performing any allocation and without depending on the current locale.
+ * Only the position of the beginning of the current line is tracked, in order to
+ * be able to report the line and the column in case of errors.
+**/
+class text_scanner {
+public:
+	/** \brief size_type is defined as an alias of size_t, an unsigned integral type. **/
+	typedef size_t size_type;
+
+	/**
+	 * \brief Constructor.
+	 * \param begin pointer to the first character to be scanned.
+	 * \param end pointer to the past-the-end character to be scanned.
+	 * \param line number of the line the first character belongs to.
+	**/
+	text_scanner(const char* begin, const char* end, const size_type line = 1)
+		: current(begin), end(end), line_begin(begin), line(line) {}
+
+	/**
+	 * \brief Reads the next integer, skipping the preceding white spaces.
+	 * \return the value read.
+	 * \throw parse_error if the next token is not a valid integer.
+	**/
+	inline int read_int() {
+		skip_whitespaces();
+		if(current == end)
+			error("unexpected end of input");
+
+		const char* start = current;
+		bool negative = false;
+		if(*current == '-' || *current == '+') {
+			negative = (*current == '-');
+			++current;
+		}
+
+		long long value = 0;
+		const char* digits = current;
+		while(current != end && is_digit(*current)) {
+			value = value*10 + (*current - '0');
+			if(value > std::numeric_limits<int>::max()) {
+				current = start;
+				error("integer out of range");
+			}
+			++current;
+		}
+
+		if(current == digits || (current != end && !is_whitespace(*current))) {
+			current = start;
+			error("expected an integer");
+		}
+		return (int)(negative ? -value : value);
+	}
+
+	/**
+	 * \brief Skips all the white spaces, updating the line information.
+	**/
+	inline void skip_whitespaces() {
+		while(current != end && is_whitespace(*current)) {
+			if(*current == '\n') {
+				line_begin = current+1;
+				++line;
+			}
+			++current;
+		}
+	}
+
+	/**
+	 * \brief Moves to the next non-empty line, returning its range.
+	 *
+	 * The line is skipped without being parsed, so that it can be scanned later (e.g. by another
+	 * thread) through a new text_scanner constructed with the returned information.
+	 *
+	 * \param begin set to the first character of the line.
+	 * \param stop set to the past-the-end character of the line (i.e. the new line character).
+	 * \param number set to the number of the line.
+	 * \return false if the end of the input has been reached, true otherwise.
+	**/
+	inline bool skip_line(const char*& begin, const char*& stop, size_type& number) {
+		skip_whitespaces();
+		if(current == end)
+			return false;
+
+		begin = line_begin;
+		number = line;
+		const char* new_line = static_cast<const char*>(std::memchr(current, '\n', end - current));
+		stop = (new_line != nullptr) ? new_line : end;
+		current = stop;
+		return true;
+	}
+
+	/**
+	 * \brief Checks that only white spaces are left in the input.
+	 * \throw parse_error if some other character is found.
+	**/
+	inline void expect_end() {
+		skip_whitespaces();
+		if(current != end)
+			error("unexpected value");
+	}
+
+	/**
+	 * \brief Returns a pointer to the next character to be scanned.
+	 * \return pointer to the current position.
+	**/
+	inline const char* position() const { return current; }
+
+private:
+	/** \brief Pointer to the next character to be scanned. **/
+	const char* current;
+	/** \brief Pointer to the past-the-end character to be scanned. **/
+	const char* end;
+	/** \brief Pointer to the first character of the current line. **/
+	const char* line_begin;
+	/** \brief Number of the current line. **/
+	size_type line;
+
+	/** \brief Returns whether the character is a white space. **/
+	static inline bool is_whitespace(const char c) {
+		return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
+	}
+
+	/** \brief Returns whether the character is a decimal digit. **/
+	static inline bool is_digit(const char c) {
+		return c >= '0' && c <= '9';
+	}
+
+	/**
+	 * \brief Throws a parse_error relative to the current position.
+	 * \param message description of the error.
+	**/
+	[[noreturn]] void error(const std::string& message) const {
+		throw parse_error(message, line, current - line_begin + 1);
+	}
+};
+
+#endif
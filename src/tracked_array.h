@@ -0,0 +1,109 @@
+// This file is part of CoIoTeSolver.
+
+// CoIoTeSolver is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// CoIoTeSolver is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with CoIoTeSolver. If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef TRACKED_ARRAY_H
+#define TRACKED_ARRAY_H
+
+#include <vector>
+
+#include "multi_array.h"
+
+/**
+ * \brief This class implements a working copy of a multi-dimensional array which can be
+ * restored to its original content in a time proportional to the number of modified elements.
+ *
+ * Each element modified through the dedicated methods is recorded in a list of touched
+ * offsets: when the array has to be restored, only those elements are copied back from
+ * the original array, instead of copying the whole content.
+ *
+ * \tparam T: Type of elements to be stored into the multi-dimensional array.
+ * \tparam N: Number of dimension such container is caracterized by.
+**/
+template <class T, size_t N>
+class tracked_array {
+public:
+	/** \brief value_type is defined as an alias of T, the type of elements stored into the container. **/
+	typedef T value_type;
+	/** \brief size_type is defined as an alias of size_t, an unsigned integral type. **/
+	typedef size_t size_type;
+	/** \brief array_type is defined as an alias of the type of the underlying multi-dimensional array. **/
+	typedef multi_array<value_type, N> array_type;
+	/** \brief index_type represents an index for the elements of the container. **/
+	typedef typename array_type::index_type index_type;
+
+	/**
+	 * \brief Constructor.
+	 *
+	 * Constructs a working copy of the array passed as parameter, which must outlive this object.
+	 *
+	 * \param original the array to be copied and used to restore the content.
+	**/
+	tracked_array(const array_type& original) : data(original), original(original) {}
+
+	/**
+	 * \brief Returns a constant reference to the element at position specified by index.
+	 * \param index the index referred to the desired element.
+	 * \return constant reference to the desired element.
+	**/
+	inline const value_type& operator[](const index_type& index) const { return data[index]; }
+
+	/**
+	 * \brief Returns a reference to the element at position specified by index, recording it as modified.
+	 * \param index the index referred to the desired element.
+	 * \return reference to the desired element.
+	**/
+	inline value_type& modify(const index_type& index) {
+		return modify(data.get_iterator(index) - data.begin());
+	}
+
+	/**
+	 * \brief Returns a reference to the element at the given offset, recording it as modified.
+	 * \param offset the offset of the desired element from the beginning of the array.
+	 * \return reference to the desired element.
+	**/
+	inline value_type& modify(const size_type& offset) {
+		touched.push_back(offset);
+		return data.begin()[offset];
+	}
+
+	/**
+	 * \brief Restores the content of the array, copying back from the original
+	 * array only the elements modified since the last call.
+	**/
+	void restore() {
+		typename array_type::const_iterator src = original.begin();
+		typename array_type::iterator dst = data.begin();
+		for(typename std::vector<size_type>::const_iterator it = touched.begin(); it != touched.end(); ++it)
+			dst[*it] = src[*it];
+		touched.clear();
+	}
+
+	/**
+	 * \brief Returns a constant reference to the underlying multi-dimensional array.
+	 * \return constant reference to the array.
+	**/
+	inline const array_type& array() const { return data; }
+
+private:
+	/** \brief The working copy of the array. **/
+	array_type data;
+	/** \brief The original array, used to restore the content. **/
+	const array_type& original;
+	/** \brief Offsets of the elements modified since the last restore. **/
+	std::vector<size_type> touched;
+};
+
+#endif